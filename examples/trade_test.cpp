@@ -10,86 +10,18 @@
  * Use in compliance with the Prosperity Public License 3.0.0.
  */
 
+#include <td365/candles.h>
 #include <td365/td365.h>
 
 #include <algorithm>
 #include <boost/core/verbose_terminate_handler.hpp>
 #include <boost/exception/diagnostic_information.hpp>
 #include <cassert>
+#include <csignal>
 #include <iostream>
 #include <spdlog/spdlog.h>
 #include <vector>
 
-struct candle_agg {
-    static constexpr int CandleSeconds = 60;
-    std::array<td365::candle, 3>
-        history{}; // [0]=current, [1]=prev, [2]=two ago
-    td365::candle current{};
-    size_t elapsed_candles = 0;
-    int64_t current_bucket = tick_bucket(std::chrono::system_clock::now());
-
-    int64_t tick_bucket(const td365::tick::time_type &t) {
-        auto secs = std::chrono::duration_cast<std::chrono::seconds>(
-                        t.time_since_epoch())
-                        .count();
-        return secs / CandleSeconds;
-    }
-
-    int n_ticks = 0;
-
-    void on_tick(const td365::tick &t) {
-        auto bucket = tick_bucket(t.timestamp);
-
-        double price = t.mid_price;
-
-        if (bucket != current_bucket) {
-            // 2. New minute → roll history down
-            auto dt = std::format("{}", current.timestamp);
-
-            spdlog::info("new candle: dt={} o={} h={} l={} close={}", dt,
-                         current.open, current.high, current.low,
-                         current.close);
-            for (size_t i = history.size() - 1; i > 0; --i) {
-                history[i] = history[i - 1];
-            }
-            history[0] = current;
-
-            // 3. Start fresh candle
-            current = td365::candle{
-                .timestamp = std::chrono::system_clock::now(),
-                .open = price,
-                .high = price,
-                .low = price,
-                .close = price,
-                .volume = 0,
-            };
-
-            current_bucket = bucket;
-            elapsed_candles++;
-        } else {
-            current.high = std::max(current.high, price);
-            current.low = std::min(current.low, price);
-            current.close = price;
-        }
-    }
-
-    bool trending_up() const {
-        return elapsed_candles > 2 && history[0].close > history[1].close &&
-               history[1].open > history[2].open;
-    }
-
-    bool trending_down() const {
-        return elapsed_candles > 2 && history[0].close < history[1].close &&
-               history[1].open < history[2].open;
-    }
-    void backfill(const std::vector<td365::candle> &v) {
-        size_t i = 0;
-        for (auto &c : v) {
-            history[i++] = c;
-        }
-    }
-};
-
 struct signals {
     enum class value { none, buy, sell };
     value last_signal = value::none;
@@ -105,49 +37,67 @@ struct signals {
 
     auto on_tick(const td365::tick &t) -> value {
         agg.on_tick(t);
-        if (agg.trending_up()) {
+        auto m1 = agg.series(t.quote_id, td365::timeframe::m1);
+        if (trending_up(m1)) {
             return alert(value::buy);
         }
-        if (agg.trending_down()) {
+        if (trending_down(m1)) {
             return alert(value::sell);
         }
         return value::none;
     }
 
-    candle_agg agg;
+    static bool trending_up(const td365::candle_series &s) {
+        return s.size() > 2 && s[0].close > s[1].close && s[1].open > s[2].open;
+    }
+
+    static bool trending_down(const td365::candle_series &s) {
+        return s.size() > 2 && s[0].close < s[1].close && s[1].open < s[2].open;
+    }
+
+    td365::candle_aggregator agg{16};
 };
 
 struct strategy {
 
-    explicit strategy(boost::asio::any_io_executor ioc) {
+    // the client runs on our own event loop, so callbacks arrive on this
+    // thread and can touch strategy state directly
+    explicit strategy(boost::asio::any_io_executor ex) : client(ex) {
         client.callbacks() = td365::user_callbacks{
-            .tick_cb =
-                [&](td365::tick &&t) {
-                    boost::asio::post(ioc, [this, t = std::move(t)]() mutable {
-                        on_tick(std::move(t));
-                    });
-                },
+            .tick_cb = [this](td365::tick &&t) { on_tick(std::move(t)); },
             .acc_summary_cb =
-                [&](td365::account_summary &&a) {
-                    boost::asio::post(ioc, [this, a = std::move(a)]() mutable {
-                        on_account_summary(std::move(a));
-                    });
+                [this](td365::account_summary &&a) {
+                    on_account_summary(std::move(a));
                 },
             .acc_detail_cb =
-                [&](td365::account_details &&a) {
-                    boost::asio::post(ioc, [this, a = std::move(a)]() mutable {
-                        on_account_details(std::move(a));
-                    });
+                [this](td365::account_details &&a) {
+                    on_account_details(std::move(a));
                 },
             .trade_response_cb =
-                [&](td365::trade_response &&r) {
-                    boost::asio::post(ioc, [this, r = std::move(r)]() mutable {
-                        on_trade_response(std::move(r));
-                    });
+                [this](td365::trade_response &&r) {
+                    on_trade_response(std::move(r));
                 },
         };
+    }
 
-        client.connect();
+    // Trades until interrupted. The client is stopped on the way out,
+    // error or not, so it is safe to destroy once the loop has returned.
+    boost::asio::awaitable<void> run() {
+        std::exception_ptr error;
+        try {
+            co_await client.async_connect(boost::asio::use_awaitable);
+            co_await setup_subscription();
+            co_await backfill();
+            boost::asio::signal_set interrupt(
+                co_await boost::asio::this_coro::executor, SIGINT, SIGTERM);
+            co_await interrupt.async_wait(boost::asio::use_awaitable);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        co_await client.async_stop(boost::asio::use_awaitable);
+        if (error) {
+            std::rethrow_exception(error);
+        }
     }
 
     int n_ticks = 0;
@@ -210,33 +160,39 @@ struct strategy {
         spdlog::info("on_trade_response");
     }
 
-    void setup_subscription() {
-        auto super_groups = client.get_market_super_group();
+    boost::asio::awaitable<void> setup_subscription() {
+        using boost::asio::use_awaitable;
+        auto super_groups =
+            co_await client.async_get_market_super_group(use_awaitable);
         auto indices = std::ranges::find_if(super_groups, [](const auto &x) {
             return x.name.compare("Indices") == 0;
         });
         assert(indices != super_groups.end());
 
-        auto second_level = client.get_market_group(indices->id);
+        auto second_level =
+            co_await client.async_get_market_group(indices->id, use_awaitable);
         auto us_item = std::ranges::find_if(second_level, [](const auto &x) {
             return x.name.compare("US") == 0;
         });
         assert(us_item != second_level.end());
 
-        auto us = client.get_market_quote(us_item->id);
+        auto us = co_await client.async_get_market_quote(us_item->id,
+                                                         use_awaitable);
         auto nasdaq = std::ranges::find_if(us, [](const auto &x) {
             return x.market_name.compare("US Tech 100") == 0;
         });
         assert(nasdaq != us.end());
 
         market = *nasdaq;
-        client.subscribe(market.quote_id);
+        co_await client.async_subscribe(
+            market.quote_id, td365::grouping::sampled, use_awaitable);
     }
 
-    void backfill() {
-        auto candles = client.backfill(market.market_id, market.quote_id, 3,
-                                       td365::chart_duration::m1);
-        signals.agg.backfill(candles);
+    boost::asio::awaitable<void> backfill() {
+        auto candles = co_await client.async_backfill(
+            market.market_id, market.quote_id, 3, td365::chart_duration::m1,
+            boost::asio::use_awaitable);
+        signals.agg.seed(market.quote_id, td365::timeframe::m1, candles);
     }
 
     td365::td365 client;
@@ -250,9 +206,13 @@ int main(int, char **) {
     boost::asio::io_context ioc;
     spdlog::set_level(spdlog::level::debug);
 
+    // feed, REST calls and strategy all on this one thread
     auto strat = strategy(ioc.get_executor());
-    strat.setup_subscription();
-    strat.backfill();
+    boost::asio::co_spawn(ioc, strat.run(), [](std::exception_ptr e) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    });
 
     ioc.run();
 
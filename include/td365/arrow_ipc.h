@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <td365/tick_store.h>
+#include <td365/types.h>
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace td365 {
+
+// Arrow IPC framing. `file` is the random-access format (.arrow, Feather
+// v2) that readers memory-map; `stream` has no footer and can be consumed
+// while it is still being written.
+enum class arrow_format { file, stream };
+
+namespace detail {
+class arrow_ipc;
+}
+
+// Writes ticks as Arrow IPC record batches, one column per `tick` field
+// plus `network_latency` (received - timestamp, see tick::network_latency).
+// Timestamps are nanosecond UTC, `dir` and `group` are strings. Rows are
+// buffered and written as a batch every `batch_rows` ticks, so `write` only
+// touches the file once per batch. The file is complete once `close` (or
+// the destructor) has run.
+class arrow_tick_writer {
+  public:
+    explicit arrow_tick_writer(const std::string &path,
+                               arrow_format format = arrow_format::file,
+                               std::size_t batch_rows = 65536);
+    ~arrow_tick_writer();
+
+    void write(const tick &t);
+
+    // Export from a tick store segment; `hash` is empty unless stored.
+    // The store keeps neither `latency` nor `decoded`, so both are null.
+    void write(const stored_tick &t);
+
+    // Write buffered rows as a (short) batch now.
+    void flush();
+
+    void close();
+
+  private:
+    std::unique_ptr<detail::arrow_ipc> ipc_;
+};
+
+// Writes candles as Arrow IPC record batches with columns timestamp, open,
+// high, low, close and volume.
+class arrow_candle_writer {
+  public:
+    explicit arrow_candle_writer(const std::string &path,
+                                 arrow_format format = arrow_format::file,
+                                 std::size_t batch_rows = 65536);
+    ~arrow_candle_writer();
+
+    void write(const candle &c);
+    void write(std::span<const candle> candles);
+
+    void flush();
+
+    void close();
+
+  private:
+    std::unique_ptr<detail::arrow_ipc> ipc_;
+};
+
+} // namespace td365
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <td365/types.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace td365 {
+
+// On-disk cache of chart candles, one file per (market, duration), kept
+// sorted oldest first and memory-mapped so a restart has its history
+// immediately. Alongside the candles it records the time ranges it is known
+// to hold completely: closed markets produce no candles, so a gap in the
+// timestamps alone does not mean data is missing. Not thread-safe.
+class candle_cache {
+  public:
+    using time_point = std::chrono::system_clock::time_point;
+
+    // [from, to]: every candle starting in the range is in the cache
+    struct range {
+        time_point from;
+        time_point to;
+    };
+
+    explicit candle_cache(std::string directory);
+    ~candle_cache();
+
+    candle_cache(const candle_cache &) = delete;
+    candle_cache &operator=(const candle_cache &) = delete;
+
+    // All cached candles, oldest first, straight from the mapping. Valid
+    // until the next `merge` for the same market and duration.
+    std::span<const candle> candles(int market_id, chart_duration dur);
+
+    // Complete ranges, oldest first.
+    std::span<const range> ranges(int market_id, chart_duration dur);
+
+    // Add the `fetched` candles (either time order) that were the latest
+    // available at `fetched_at`. Newer copies replace cached candles with
+    // the same timestamp, since the last candle of an earlier fetch may have
+    // still been forming.
+    void merge(int market_id, chart_duration dur,
+               std::span<const candle> fetched, time_point fetched_at);
+
+  private:
+    struct entry {
+        int fd = -1;
+        const char *map = nullptr;
+        std::size_t map_len = 0;
+        const candle *base = nullptr;
+        std::size_t count = 0;
+        std::vector<range> ranges;
+        std::string ranges_path;
+    };
+
+    entry &open(int market_id, chart_duration dur);
+    void remap(entry &e);
+    void save_ranges(const entry &e);
+
+    std::string directory_;
+    std::map<std::pair<int, chart_duration>, entry> entries_;
+};
+
+constexpr std::chrono::seconds to_duration(chart_duration dur) {
+    switch (dur) {
+    case chart_duration::m1:
+        return std::chrono::minutes(1);
+    default:
+        return std::chrono::seconds(0);
+    }
+}
+
+} // namespace td365
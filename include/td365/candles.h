@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <td365/types.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <unordered_map>
+
+namespace td365 {
+
+enum class timeframe { s1, m1, m5, h1, _count };
+
+constexpr std::chrono::seconds to_duration(timeframe tf) {
+    switch (tf) {
+    case timeframe::s1:
+        return std::chrono::seconds(1);
+    case timeframe::m1:
+        return std::chrono::minutes(1);
+    case timeframe::m5:
+        return std::chrono::minutes(5);
+    case timeframe::h1:
+        return std::chrono::hours(1);
+    default:
+        return std::chrono::seconds(0);
+    }
+}
+
+// Read-only view of one quote's candles at one timeframe, as of the call to
+// `candle_aggregator::series`. Fetch a new one after feeding more ticks.
+class candle_series {
+  public:
+    // completed candles held, at most the aggregator's history size
+    std::size_t size() const { return count_; }
+
+    // 0 is the most recently completed candle
+    const candle &operator[](std::size_t i) const {
+        return ring_[(head_ + capacity_ - 1 - i) % capacity_];
+    }
+
+    // the candle still being built, if any tick has arrived for it
+    bool has_current() const { return open_; }
+    const candle &current() const { return current_; }
+
+  private:
+    friend class candle_aggregator;
+    candle_series(const candle *ring, std::size_t capacity, std::size_t head,
+                  std::size_t count, bool open, const candle &current)
+        : ring_(ring), capacity_(capacity), head_(head), count_(count),
+          open_(open), current_(current) {}
+
+    const candle *ring_;
+    std::size_t capacity_;
+    std::size_t head_;
+    std::size_t count_;
+    bool open_;
+    candle current_;
+};
+
+// Builds OHLC candles from ticks for every quote at 1s, 1m, 5m and 1h at
+// once. Each (quote, timeframe) keeps a fixed ring of completed candles, so
+// after a quote's first tick (or `track`) updates are O(1) and never
+// allocate. Prices are tick mids; volume counts ticks. Not thread-safe:
+// feed it and read it from the same thread.
+class candle_aggregator {
+  public:
+    using close_cb_type =
+        std::function<void(int quote_id, timeframe tf, const candle &)>;
+
+    explicit candle_aggregator(std::size_t history = 512);
+
+    // Allocate storage for a quote ahead of its first tick.
+    void track(int quote_id);
+
+    void on_tick(const tick &t);
+
+    // Load history, e.g. from `rest_api::backfill`, in either time order.
+    // The candles also roll up into every coarser timeframe. The newest
+    // candle becomes the current one, so ticks in the same period extend it
+    // rather than starting a duplicate. Does not invoke the close callback.
+    void seed(int quote_id, timeframe tf, std::span<const candle> candles);
+
+    // Called each time a candle completes.
+    void set_on_close(close_cb_type cb) { on_close_ = std::move(cb); }
+
+    candle_series series(int quote_id, timeframe tf) const;
+
+  private:
+    static constexpr auto timeframes = static_cast<size_t>(timeframe::_count);
+
+    struct state {
+        std::int64_t bucket = 0;
+        bool open = false;
+        candle current{};
+        std::size_t head = 0;
+        std::size_t count = 0;
+    };
+
+    struct quote_state {
+        std::array<state, timeframes> series;
+        std::unique_ptr<candle[]> rings; // timeframes * history
+    };
+
+    quote_state &slot(int quote_id);
+
+    void apply(int quote_id, quote_state &q, size_t tf, std::int64_t bucket,
+               const candle &c, bool notify);
+
+    std::size_t history_;
+    std::unordered_map<int, quote_state> quotes_;
+    close_cb_type on_close_;
+};
+
+} // namespace td365
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace td365 {
+
+class ws_client;
+
+// Capture file layout:
+//   header: "TD365CAP" | u32 version | u32 reserved
+//   record: i64 receive time (ns since epoch) | u32 length | payload
+// Records are packed back to back. A zeroed record header marks the end of
+// a file that was not closed cleanly.
+struct capture_frame {
+    using time_type = std::chrono::time_point<std::chrono::system_clock,
+                                              std::chrono::nanoseconds>;
+    time_type received;
+    std::string_view payload; // points into the mapped file
+};
+
+// Appends raw frames to a memory-mapped capture file. `append` is a memcpy
+// into the current mapping; the file is only extended (fallocate + mmap) once
+// per `window` bytes, so the feed thread never waits on a write(2). Windows
+// are mapped lazily and kept small: pages fault in one at a time as frames
+// are written, rather than the whole window at once when it is mapped. If a
+// window cannot be extended or mapped, say on a full disk, the error is
+// logged and capture stops; the feed carries on.
+class capture_writer {
+  public:
+    static constexpr std::size_t default_window = 4U * 1024U * 1024U;
+
+    explicit capture_writer(const std::string &path,
+                            std::size_t window = default_window);
+    ~capture_writer();
+
+    capture_writer(const capture_writer &) = delete;
+    capture_writer &operator=(const capture_writer &) = delete;
+
+    void append(capture_frame::time_type received, std::string_view payload);
+
+    std::uint64_t frames() const { return frames_; }
+    std::uint64_t bytes() const { return pos_; }
+    // stopped after an error; later frames are not recorded
+    bool failed() const { return failed_; }
+
+  private:
+    void remap(std::size_t needed);
+
+    int fd_ = -1;
+    char *base_ = nullptr;    // start of the current mapping
+    std::size_t map_off_ = 0; // file offset of base_
+    std::size_t map_len_ = 0;
+    std::size_t pos_ = 0; // absolute write offset
+    std::size_t window_;
+    std::uint64_t frames_ = 0;
+    bool failed_ = false;
+};
+
+// Sequential reader over a capture file. The file is mapped read-only and
+// frames are returned as views into the mapping.
+class capture_reader {
+  public:
+    explicit capture_reader(const std::string &path);
+    ~capture_reader();
+
+    capture_reader(const capture_reader &) = delete;
+    capture_reader &operator=(const capture_reader &) = delete;
+
+    bool next(capture_frame &frame);
+    void rewind();
+
+  private:
+    int fd_ = -1;
+    const char *base_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t pos_ = 0;
+};
+
+enum class replay_speed { recorded, maximum };
+
+struct replay_stats {
+    std::uint64_t frames = 0;
+    std::chrono::nanoseconds elapsed{};
+};
+
+// Push every frame of `reader` through `client`'s dispatch and tick decode on
+// the calling thread. With replay_speed::recorded the original inter-frame
+// gaps are reproduced, otherwise frames are pushed back to back.
+replay_stats replay(capture_reader &reader, ws_client &client,
+                    replay_speed speed = replay_speed::maximum);
+
+} // namespace td365
@@ -21,7 +21,7 @@ class cookiejar {
 
     void save() const;
 
-    void update(const http_response &res);
+    void update(const http_response_header &res);
 
     void apply(http_request &req);
 
@@ -12,7 +12,8 @@
 
 namespace td365 {
 using http_response =
-    boost::beast::http::response<boost::beast::http::dynamic_body>;
+    boost::beast::http::response<boost::beast::http::string_body>;
+using http_response_header = boost::beast::http::response_header<>;
 using http_request =
     boost::beast::http::request<boost::beast::http::string_body>;
 using http_headers = std::unordered_multimap<std::string, std::string>;
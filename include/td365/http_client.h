@@ -6,29 +6,61 @@
  */
 #pragma once
 
-#include "boost/beast/http/dynamic_body.hpp"
+#include "boost/beast/http/string_body.hpp"
 #include "boost/beast/http/message.hpp"
 #include "boost/url/url.hpp"
 #include <td365/cookiejar.h>
 #include <td365/http.h>
+#include <td365/net_profile.h>
 
 #include <boost/asio.hpp>
 #include <boost/asio/awaitable.hpp>
 #include <boost/asio/ssl.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/beast/ssl.hpp>
 #include <chrono>
+#include <functional>
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace td365 {
 
 extern http_headers const no_headers;
 extern http_headers const application_json_headers;
 
+struct http_client_options {
+    // requests beyond this many in flight wait for a connection to free up;
+    // lowering it closes idle connections beyond it as they are next looked
+    // for
+    std::size_t max_connections = 4;
+    // idle connections older than this are closed rather than reused, so
+    // they are gone before the server's keep-alive timeout can race a
+    // request
+    std::chrono::seconds max_idle{30};
+    // applied to every new connection
+    socket_options sockets{};
+    unsigned short port = 443; // of the host, for servers off the default
+};
+
+struct request_timing {
+    std::chrono::steady_clock::time_point written; // request sent
+    // the first read off the socket returned, before any of the response
+    // was parsed
+    std::chrono::steady_clock::time_point first_byte;
+};
+
+// HTTPS client for one host. Keeps a pool of keep-alive connections so
+// concurrent requests each get their own; the connections share cookies
+// and default headers. Idle connections are health-checked before reuse
+// and evicted once stale. Not thread-safe: use from one executor.
 struct http_client {
 
-    http_client(boost::asio::any_io_executor, std::string host);
+    http_client(boost::asio::any_io_executor, std::string host,
+                http_client_options opts = {});
     virtual ~http_client() = default;
     http_client(const http_client &) = delete;
     http_client(http_client &&) = delete;
@@ -39,30 +71,133 @@ struct http_client {
     get(std::string_view target,
         std::optional<http_headers> headers = std::nullopt);
 
+    // With `timing`, records when the request went out and when the
+    // response started to arrive.
     boost::asio::awaitable<http_response>
     post(std::string_view target,
          std::optional<std::string> body = std::nullopt,
-         std::optional<http_headers> header = std::nullopt);
+         std::optional<http_headers> header = std::nullopt,
+         request_timing *timing = nullptr);
+
+    using body_handler = std::function<void(std::string_view)>;
+
+    // Like post, but the body of a successful (2xx) response is
+    // decompressed into the connection's own buffer and handed to
+    // `on_body` before the connection is released, so concurrent requests
+    // never share a buffer. The view is only valid during the call.
+    boost::asio::awaitable<http_response_header>
+    post_decoded(std::string_view target, std::optional<std::string> body,
+                 body_handler on_body,
+                 std::optional<http_headers> headers = std::nullopt,
+                 request_timing *timing = nullptr);
+
+    // Like get/post, but the body is not buffered: it is handed to
+    // `on_body` piece by piece as it arrives, already decompressed. Only
+    // the body of a successful (2xx) response is passed on; check the
+    // returned header for the status.
+    boost::asio::awaitable<http_response_header>
+    get_streamed(std::string_view target, body_handler on_body,
+                 std::optional<http_headers> headers = std::nullopt);
+
+    boost::asio::awaitable<http_response_header>
+    post_streamed(std::string_view target, std::optional<std::string> body,
+                  body_handler on_body,
+                  std::optional<http_headers> headers = std::nullopt);
 
     http_headers &default_headers() { return default_headers_; };
 
-    const cookiejar &jar() const { return jar_; }
+    const cookiejar &jar() const { return *jar_; }
+
+    // Use `other`'s cookie jar from now on, so a second client for the same
+    // host carries the same login; default headers are copied as they are.
+    void share_session(const http_client &other);
+
+    // Keep a connection ready for the next request: open one if none is
+    // idle, and if the freshest idle one has gone `refresh` without use,
+    // POST `target` over it so the server's keep-alive timer restarts.
+    // Does nothing while every connection is in use.
+    boost::asio::awaitable<void> warm(std::string_view target,
+                                      std::chrono::seconds refresh);
+
+    http_client_options &options() { return opts_; }
+
+    // open connections, idle or in use
+    std::size_t connections() const { return pool_.size(); }
 
   private:
-    boost::asio::awaitable<void> ensure_connected();
+    using stream_t = boost::asio::ssl::stream<boost::asio::ip::tcp::socket>;
+
+    struct connection {
+        explicit connection(boost::asio::any_io_executor ex);
+
+        stream_t stream;
+        // kept for the life of the connection so reads stop allocating once
+        // they have grown to fit
+        boost::beast::flat_buffer buffer;
+        std::vector<char> window; // body window for streamed reads
+        std::string decoded;      // decompressed bodies for post_decoded
+        std::chrono::steady_clock::time_point last_used;
+        std::size_t requests = 0;
+        bool busy = false;
+    };
+
+    // A connection checked out of the pool. It goes back when the lease
+    // ends if marked reusable, and is closed otherwise.
+    class lease {
+      public:
+        lease(http_client &owner, connection &conn);
+        lease(lease &&other) noexcept;
+        lease &operator=(lease &&) = delete;
+        ~lease();
+
+        stream_t &stream() { return conn_->stream; }
+        boost::beast::flat_buffer &buffer() { return conn_->buffer; }
+        std::vector<char> &window() { return conn_->window; }
+        std::string &decoded() { return conn_->decoded; }
+        // has carried an earlier request, so may have gone stale
+        bool reused() const { return conn_->requests > 1; }
+        void keep(bool reusable) { reusable_ = reusable; }
+
+      private:
+        http_client *owner_;
+        connection *conn_;
+        bool reusable_ = false;
+    };
+
+    // closes stale idle connections and returns the most recently used of
+    // the rest, if any
+    connection *idle_connection();
+    boost::asio::awaitable<lease> acquire();
+    void release(connection &conn, bool reusable);
+    bool healthy(connection &conn,
+                 std::chrono::steady_clock::time_point now) const;
+    boost::asio::awaitable<void> connect(connection &conn);
 
     std::map<std::string, std::string> set_req_defaults(
         boost::beast::http::request<boost::beast::http::string_body> &req);
 
+    http_request make_request(boost::beast::http::verb verb,
+                              std::string_view target,
+                              std::optional<std::string> body,
+                              std::optional<http_headers> headers);
+
     boost::asio::awaitable<http_response>
     send(boost::beast::http::verb verb, std::string_view target,
-         std::optional<std::string> body, std::optional<http_headers> headers);
+         std::optional<std::string> body, std::optional<http_headers> headers,
+         request_timing *timing = nullptr,
+         const body_handler *on_decoded = nullptr);
 
-    using stream_t = boost::asio::ssl::stream<boost::asio::ip::tcp::socket>;
-    stream_t stream_;
+    boost::asio::awaitable<http_response_header>
+    send_streamed(boost::beast::http::verb verb, std::string_view target,
+                  std::optional<std::string> body,
+                  std::optional<http_headers> headers, body_handler on_body);
 
     const std::string host_;
-    cookiejar jar_;
+    std::shared_ptr<cookiejar> jar_;
     http_headers default_headers_;
+    http_client_options opts_;
+
+    std::vector<std::unique_ptr<connection>> pool_;
+    boost::asio::steady_timer connection_freed_;
 };
 } // namespace td365
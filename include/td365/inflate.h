@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct z_stream_s;
+
+namespace td365 {
+
+// Incremental gzip decoder: compressed input goes in as it arrives and
+// the decompressed bytes come out through `out` a window at a time, so a
+// body never has to be held whole in either form.
+class gzip_inflater {
+  public:
+    using output_handler = std::function<void(std::string_view)>;
+
+    gzip_inflater();
+    ~gzip_inflater();
+
+    gzip_inflater(const gzip_inflater &) = delete;
+    gzip_inflater &operator=(const gzip_inflater &) = delete;
+
+    // Throws on corrupt input. Anything after the end of the gzip member
+    // is ignored.
+    void feed(std::string_view in, const output_handler &out);
+
+    // Decompress `in` straight into `out` starting at `used`, growing `out`
+    // only if it is too small, and advance `used` past what was written.
+    // With `out` sized up front there are no intermediate copies.
+    void feed(std::string_view in, std::string &out, std::size_t &used);
+
+    // the end of the gzip member has been seen
+    bool done() const { return done_; }
+
+    void reset();
+
+  private:
+    std::unique_ptr<z_stream_s> zs_;
+    std::vector<char> window_;
+    bool done_ = false;
+};
+
+} // namespace td365
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace td365 {
+
+// Picks the elements of one array out of a JSON document that arrives in
+// pieces, handing each to `on_element` as raw JSON text as soon as it is
+// complete, so records can be decoded while the rest of the body is still
+// on the wire. The array is either the member `key` of the root object or,
+// with an empty key, the root itself. Everything outside the array is only
+// scanned, never stored. The input is assumed to be well-formed JSON.
+class json_array_stream {
+  public:
+    using element_handler = std::function<void(std::string_view)>;
+
+    json_array_stream(std::string key, element_handler on_element);
+
+    void feed(std::string_view chunk);
+
+    // the array has been closed
+    bool done() const { return done_; }
+
+  private:
+    void emit(std::string_view chunk, std::size_t end);
+
+    std::string key_;
+    element_handler on_element_;
+
+    int depth_ = 0;
+    bool in_string_ = false;
+    bool escape_ = false;
+    bool expect_key_ = false;
+    bool capture_key_ = false;
+    std::string current_key_;
+
+    int array_depth_ = -1; // depth inside the target array, once found
+    bool done_ = false;
+    std::size_t start_ = std::string_view::npos; // element start in chunk
+    std::string partial_; // element carried over from earlier chunks
+};
+
+} // namespace td365
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <boost/asio/ip/tcp.hpp>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+namespace td365 {
+
+// Defaults leave every socket as the kernel opens it.
+struct socket_options {
+    bool tcp_nodelay = false;
+    int receive_buffer = 0; // SO_RCVBUF bytes, 0 = kernel default
+    int busy_poll_us = 0;   // SO_BUSY_POLL, 0 = disabled
+};
+
+struct network_profile {
+    socket_options sockets;
+    bool busy_poll = false; // spin io_context::poll() instead of run()
+    int cpu = -1;           // pin the io thread to this core, -1 = unpinned
+
+    // Trades a whole core for lower and more stable tick latency.
+    static network_profile low_latency(int cpu) {
+        return network_profile{
+            .sockets = {.tcp_nodelay = true,
+                        .receive_buffer = 4 * 1024 * 1024,
+                        .busy_poll_us = 50},
+            .busy_poll = true,
+            .cpu = cpu,
+        };
+    }
+};
+
+// Time from the polling loop picking up work to a websocket message having
+// been read. Only sampled when the io thread runs with busy_poll.
+struct wakeup_stats {
+    std::uint64_t samples = 0;
+    std::chrono::nanoseconds min{};
+    std::chrono::nanoseconds max{};
+    std::chrono::nanoseconds mean{};
+};
+
+// Wake-up samples of one busy-poll loop. The loop's thread records, any
+// thread may read.
+class wakeup_recorder {
+  public:
+    // Called by the busy-poll loop before each poll(). Reads on this thread
+    // are recorded here from then on.
+    void mark();
+
+    wakeup_stats stats() const;
+
+  private:
+    friend void record_read();
+    void record(std::int64_t ns);
+
+    std::chrono::steady_clock::time_point last_wakeup_{};
+    std::atomic<std::uint64_t> samples_{0};
+    std::atomic<std::int64_t> total_ns_{0};
+    std::atomic<std::int64_t> min_ns_{
+        std::numeric_limits<std::int64_t>::max()};
+    std::atomic<std::int64_t> max_ns_{0};
+};
+
+void apply_socket_options(boost::asio::ip::tcp::socket &socket,
+                          const socket_options &opts);
+
+void pin_thread(int cpu);
+
+// Called after a websocket message has been read; a sample for the
+// recorder whose loop runs this thread, if any.
+void record_read();
+
+} // namespace td365
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <td365/types.h>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace td365 {
+
+// Request body for RequestTrade and RequestTradeSimulate, prepared once per
+// market. Everything but price, stake, stop, limit, direction and key is
+// laid out ahead of time; rendering copies the fixed text and formats the
+// six fields into a buffer that is reused from order to order.
+//
+// The text is what dumping the equivalent nlohmann::json object gives:
+// keys sorted, stake/stop/limit as "%f" strings, the price in shortest
+// round-trip form. Prices that would need an exponent are rejected.
+class order_template {
+  public:
+    order_template(int market_id, int quote_id);
+
+    int market_id() const { return market_id_; }
+    int quote_id() const { return quote_id_; }
+
+    // Throws if `request` is for another market or quote, or if its key is
+    // not base64. The view is valid until the next call.
+    std::string_view render(const trade_request &request);
+
+    // The same, written into `out` in place of its contents, such as the
+    // string that becomes the request body.
+    void render(const trade_request &request, std::string &out) const;
+
+  private:
+    int market_id_;
+    int quote_id_;
+    // the fixed text carrying the market and quote ids
+    std::string after_limit_;
+    std::string after_price_;
+    std::string buffer_;
+
+    // room for the body with a typical key
+    std::size_t capacity() const;
+};
+
+} // namespace td365
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace td365 {
+
+// Points in an order's life, in the order they happen. Steps that were
+// skipped (cached details, simulate turned off) are left unset.
+enum class order_stage : std::size_t {
+    submitted,     // td365::trade called, on the caller's thread
+    started,       // the order coroutine is running on the io thread
+    details_sent,  // GetMarketDetails request
+    details_done,
+    simulate_sent, // RequestTradeSimulate request
+    simulate_done,
+    trade_sent,    // RequestTrade: body built, waiting for a connection
+    trade_written, // request written to the socket
+    first_byte,    // first part of the response read
+    trade_done,    // response parsed
+    callback,      // trade_response_cb about to be called
+    count
+};
+
+struct order_trace {
+    using clock = std::chrono::steady_clock;
+
+    std::uint64_t id = 0; // as returned by td365::trade
+    int market_id = 0;
+    int quote_id = 0;
+    bool ok = false; // the order was acknowledged
+    std::array<clock::time_point, static_cast<std::size_t>(order_stage::count)>
+        at{};
+
+    void mark(order_stage s) { at[static_cast<std::size_t>(s)] = clock::now(); }
+
+    bool reached(order_stage s) const {
+        return at[static_cast<std::size_t>(s)] != clock::time_point{};
+    }
+
+    // Time from `from` to `to`, zero if either was not reached.
+    clock::duration between(order_stage from, order_stage to) const {
+        if (!reached(from) || !reached(to)) {
+            return {};
+        }
+        return at[static_cast<std::size_t>(to)] -
+               at[static_cast<std::size_t>(from)];
+    }
+};
+
+// Finished traces waiting to be collected. Written on the io thread,
+// drained from any thread. Holds at most `capacity`, dropping the oldest.
+class order_trace_log {
+  public:
+    explicit order_trace_log(std::size_t capacity = 4096)
+        : capacity_(capacity) {}
+
+    void push(const order_trace &trace);
+
+    // Appends every trace collected since the last drain to `out`, oldest
+    // first.
+    void drain(std::vector<order_trace> &out);
+
+    // traces lost because nobody drained them in time
+    std::uint64_t dropped() const;
+
+  private:
+    const std::size_t capacity_;
+    mutable std::mutex mutex_;
+    std::deque<order_trace> traces_;
+    std::uint64_t dropped_ = 0;
+};
+
+} // namespace td365
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <td365/types.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace td365 {
+
+struct top_of_book {
+    int quote_id;
+    double bid;
+    double ask;
+    double mid_price;
+    tick::time_type timestamp; // server time of the last update
+    tick::time_type received;  // local arrival time of the last update
+};
+
+// Last bid/ask per quote, written by the feed thread and readable from any
+// number of threads without locks. Each slot is a seqlock: readers retry
+// when they race a write, the writer never waits for readers.
+class quote_cache {
+  public:
+    // `capacity` is rounded up to a power of two; quotes beyond it are not
+    // cached.
+    explicit quote_cache(std::size_t capacity = 4096);
+
+    // Feed thread only. Ticks older than the cached one are ignored, so a
+    // delayed stream can't overwrite a live one.
+    void update(const tick &t);
+
+    // Any thread.
+    std::optional<top_of_book> get(int quote_id) const;
+
+    std::size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+  private:
+    // one cache line per quote so readers of different quotes don't contend
+    struct alignas(64) slot {
+        std::atomic<int> quote_id{0}; // 0 = free
+        std::atomic<std::uint64_t> seq{0};
+        std::atomic<double> bid{0};
+        std::atomic<double> ask{0};
+        std::atomic<double> mid_price{0};
+        std::atomic<std::int64_t> timestamp{0};
+        std::atomic<std::int64_t> received{0};
+    };
+
+    const slot *find(int quote_id) const;
+    slot *find_or_insert(int quote_id);
+
+    std::unique_ptr<slot[]> slots_;
+    std::size_t mask_;
+    std::atomic<std::size_t> size_{0};
+    bool full_warned_ = false;
+};
+
+} // namespace td365
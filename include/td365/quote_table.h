@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <td365/types.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace td365 {
+
+// Columnar view of every quote seen on the feed: one contiguous array per
+// field, so cross-sectional scans are plain loops the compiler can
+// vectorise. The feed thread updates a private copy and publishes it into
+// one of two buffers; readers pin the published buffer for as long as they
+// hold a snapshot. Publishing skips a buffer that is still pinned, so
+// readers never stall the feed, they only delay the next snapshot.
+class quote_table {
+    struct columns {
+        std::vector<int> quote_id;
+        std::vector<double> bid;
+        std::vector<double> ask;
+        std::vector<double> mid_price;
+        std::vector<double> high;
+        std::vector<double> low;
+        std::vector<double> daily_change;
+        std::vector<std::int64_t> timestamp; // ns since epoch, server time
+
+        void resize(std::size_t n);
+        void copy_row(const columns &from, std::size_t row);
+    };
+
+  public:
+    class snapshot {
+      public:
+        snapshot(const snapshot &) = delete;
+        snapshot &operator=(const snapshot &) = delete;
+        snapshot(snapshot &&other) noexcept;
+        ~snapshot();
+
+        std::size_t size() const { return cols_->quote_id.size(); }
+        // number of publishes so far; unchanged means no new data
+        std::uint64_t version() const { return version_; }
+
+        std::span<const int> quote_id() const { return cols_->quote_id; }
+        std::span<const double> bid() const { return cols_->bid; }
+        std::span<const double> ask() const { return cols_->ask; }
+        std::span<const double> mid_price() const { return cols_->mid_price; }
+        std::span<const double> high() const { return cols_->high; }
+        std::span<const double> low() const { return cols_->low; }
+        std::span<const double> daily_change() const {
+            return cols_->daily_change;
+        }
+        std::span<const std::int64_t> timestamp() const {
+            return cols_->timestamp;
+        }
+
+      private:
+        friend class quote_table;
+        snapshot(const columns *cols, std::atomic<int> *pin,
+                 std::uint64_t version)
+            : cols_(cols), pin_(pin), version_(version) {}
+
+        const columns *cols_;
+        std::atomic<int> *pin_;
+        std::uint64_t version_;
+    };
+
+    // Feed thread only. Rows are added the first time a quote is seen and
+    // keep their position for the lifetime of the table. Like
+    // quote_cache::update, ticks older than the row's are ignored.
+    void update(const tick &t);
+
+    // Feed thread only. Makes updates since the last publish visible to new
+    // snapshots, unless the target buffer is still held by a reader.
+    void publish();
+
+    // Any thread. Holds the latest published buffer until destroyed.
+    snapshot acquire() const;
+
+  private:
+    columns master_;
+    std::unordered_map<int, std::size_t> rows_;
+
+    std::array<columns, 2> buffers_;
+    // rows changed since each buffer was last written
+    std::array<std::vector<std::size_t>, 2> dirty_;
+    std::array<std::vector<bool>, 2> is_dirty_;
+
+    mutable std::array<std::atomic<int>, 2> pins_{};
+    std::atomic<int> front_{0};
+    std::array<std::uint64_t, 2> versions_{};
+    std::uint64_t published_ = 0;
+};
+
+} // namespace td365
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace td365 {
+
+struct connect_options {
+    // How long a resolved address list is reused. getaddrinfo doesn't
+    // report record TTLs, so this stands in for them; keep it at or below
+    // the TTL the zone actually publishes.
+    std::chrono::seconds dns_ttl{60};
+    // Head start each endpoint gets before the next one is tried in
+    // parallel (RFC 8305 recommends 250ms).
+    std::chrono::milliseconds attempt_delay{250};
+    // Gives up on the whole race after this long.
+    std::chrono::seconds timeout{30};
+};
+
+struct resolver_stats {
+    std::uint64_t lookups = 0;    // td_resolve calls
+    std::uint64_t cache_hits = 0; // of those, answered from the cache
+};
+
+// Resolves `host`, or the PROXY environment variable's host when set.
+// Answers are cached process-wide for `dns_ttl`.
+boost::asio::awaitable<boost::asio::ip::tcp::resolver::results_type>
+td_resolve(std::string_view host, std::string_view port,
+           const connect_options &opts = {});
+
+// Drop the cached answer for `host`, e.g. after none of its addresses
+// could be reached.
+void forget_resolved(std::string_view host, std::string_view port);
+
+// Happy-eyeballs connect: endpoints are tried alternating between address
+// families, each new attempt starting when the previous one fails or after
+// `attempt_delay`, whichever is first. The first to connect wins and the
+// rest are abandoned.
+boost::asio::awaitable<boost::asio::ip::tcp::socket>
+race_connect(std::span<const boost::asio::ip::tcp::endpoint> endpoints,
+             const connect_options &opts = {});
+
+// td_resolve then race_connect. If no endpoint connects the cached answer
+// is dropped so the next attempt resolves afresh.
+boost::asio::awaitable<boost::asio::ip::tcp::socket>
+td_connect(std::string_view host, std::string_view port,
+           const connect_options &opts = {});
+
+resolver_stats read_resolver_stats();
+
+} // namespace td365
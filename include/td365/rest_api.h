@@ -7,22 +7,57 @@
 
 #pragma once
 
+#include <td365/net_profile.h>
+#include <td365/order_template.h>
+#include <td365/order_trace.h>
 #include <td365/types.h>
 
 #include <boost/asio.hpp>
 #include <boost/asio/awaitable.hpp>
 #include <boost/url/url.hpp>
+#include <chrono>
+#include <exception>
+#include <functional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace td365 {
 
+class candle_cache;
 struct http_client;
 struct market;
 struct market_group;
 
 using boost::asio::awaitable;
 
+struct backfill_request {
+    int market_id;
+    int quote_id;
+    size_t sz;
+    chart_duration dur = chart_duration::m1;
+};
+
+struct backfill_result {
+    backfill_request request;
+    std::vector<candle> candles; // oldest first
+    std::exception_ptr error;    // set if this market failed
+};
+
+struct order_options {
+    // Send RequestTradeSimulate before each order, as the web client does.
+    bool simulate = true;
+    // Reuse a market's details and trading rules for this long before
+    // fetching them again ahead of an order; zero fetches them every time.
+    std::chrono::seconds details_ttl{0};
+
+    // One round trip per order once a market's details are cached.
+    static order_options fast() {
+        return order_options{.simulate = false,
+                             .details_ttl = std::chrono::minutes(5)};
+    }
+};
+
 class rest_api : public std::enable_shared_from_this<rest_api> {
   public:
     struct auth_info {
@@ -43,18 +78,88 @@ class rest_api : public std::enable_shared_from_this<rest_api> {
     auto get_market_group(int super_group_id)
         -> awaitable<std::vector<market_group>>;
     auto get_market_quote(int group_id) -> awaitable<std::vector<market>>;
+    // Also prepares the market's order template, see order_template.h.
     auto get_market_details(int market_id)
         -> awaitable<market_details_response>;
     // auto get_chart_url(int market_id) -> awaitable<boost::urls::url>;
+
+    // The last `sz` candles, oldest first. With a candle cache set only the
+    // candles since the cache was last brought up to date are downloaded.
     auto backfill(int market_id, int quote_id, size_t sz, chart_duration dur)
         -> awaitable<std::vector<candle>>;
-    auto trade(const trade_request &request) -> awaitable<trade_response>;
+    void set_candle_cache(std::unique_ptr<candle_cache> cache);
+    // For the connections of clients created from now on; call before
+    // `connect`.
+    void set_socket_options(const socket_options &opts) { sockets_ = opts; }
+
+    // Backfill many markets, up to `concurrency` at a time, each over its
+    // own pooled chart-host connection. `on_result` is called as each
+    // market completes, in completion order; a failed market does not stop
+    // the others.
+    auto backfill(std::vector<backfill_request> requests, size_t concurrency,
+                  std::function<void(backfill_result &&)> on_result)
+        -> awaitable<void>;
+    // `trace`, if given, gets the trade_sent..trade_done stages.
+    auto trade(const trade_request &request, order_trace *trace = nullptr)
+        -> awaitable<trade_response>;
     auto sim_trade(const trade_request &request) -> awaitable<void>;
 
+    // Details (unless cached), simulate (if enabled), then trade. A failed
+    // order drops the market's cached details. Each step is marked in
+    // `trace`, if given.
+    auto place_order(const trade_request &request,
+                     order_trace *trace = nullptr)
+        -> awaitable<trade_response>;
+    void set_order_options(const order_options &opts) { order_opts_ = opts; }
+    void invalidate_market_details(int market_id) {
+        details_.erase(market_id);
+    }
+
+    // Keep a dedicated connection to the trading host open for orders, so
+    // a trade never waits for a connect or TLS handshake. It is checked
+    // every second, reopened as soon as it drops and refreshed with a
+    // cheap request after `refresh` without use. Runs until stop_warming.
+    auto warm_order_path(std::chrono::seconds refresh = std::chrono::seconds(15))
+        -> awaitable<void>;
+    void stop_warming();
+
   private:
     std::unique_ptr<http_client> client_;
+    // orders and market details only, shares client_'s session
+    std::unique_ptr<http_client> order_client_;
+    std::unique_ptr<boost::asio::steady_timer> warm_timer_;
+    bool warm_stopped_ = false;
     std::string account_id_;
     std::string get_market_details_url_;
+    std::unique_ptr<candle_cache> candles_;
+    socket_options sockets_;
+
+    struct cached_details {
+        market_details_response details;
+        std::chrono::steady_clock::time_point fetched;
+    };
+    order_options order_opts_;
+    std::unordered_map<int, cached_details> details_;
+    // order bodies by market id, prepared with the details or on first use
+    std::unordered_map<int, order_template> templates_;
+
+    order_template &order_template_for(int market_id, int quote_id);
+
+    // pooled keep-alive connections to the chart host, reused across
+    // backfills
+    std::unique_ptr<http_client> chart_client_;
+    // batch backfills running, and the chart pool's limit before the
+    // first of them widened it
+    size_t chart_batches_ = 0;
+    size_t chart_connections_ = 0;
+
+    http_client &chart_client(boost::asio::any_io_executor ex);
+    http_client &order_client();
+
+    auto fetch_candles(http_client &hc, int market_id, size_t sz)
+        -> awaitable<std::vector<candle>>;
+    auto backfill_on(http_client &hc, int market_id, size_t sz,
+                     chart_duration dur) -> awaitable<std::vector<candle>>;
 
     auto open_client(std::string_view target, int depth = 0)
         -> awaitable<std::pair<std::string, std::string>>;
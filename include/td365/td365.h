@@ -8,13 +8,21 @@
 #pragma once
 
 #include <td365/authenticator.h>
+#include <td365/net_profile.h>
+#include <td365/order_trace.h>
 #include <td365/rest_api.h>
+#include <td365/tick_store.h>
+#include <td365/tls.h>
 #include <td365/types.h>
+#include <td365/verify.h>
 #include <td365/ws_client.h>
 
+#include <exception>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace td365 {
@@ -30,8 +38,22 @@ concept UserCallbacksLike = requires(H h, tick &&t, account_summary &&a,
 
 class td365 {
   public:
+    // Runs the client on a private io_context and thread of its own;
+    // callbacks are called on that thread.
     explicit td365();
 
+    // Runs the client on `executor`, which the caller runs. Feed, REST
+    // calls and callbacks then share the caller's event loop and thread,
+    // with no handoff between threads. The client keeps its state on a
+    // strand of `executor`, so the loop may be run by several threads.
+    // Connect with `async_connect`; the blocking calls would wait on the
+    // thread meant to do the work. The network profile's socket options
+    // apply, its busy polling and CPU pinning are left to whoever runs the
+    // executor. Complete async_stop before destroying the client.
+    explicit td365(boost::asio::any_io_executor executor);
+
+    // With its own io_context, calls stop(). On a caller's executor it
+    // cannot wait, so async_stop must have completed first.
     ~td365();
 
     user_callbacks &callbacks() { return callbacks_; }
@@ -41,37 +63,272 @@ class td365 {
 
     void connect();
 
-    void subscribe(int quote_id);
-    void unsubscribe(int quote_id);
+    // Completes once the REST session is up and the feed has
+    // authenticated. Completion signature is void(std::exception_ptr).
+    template <typename CompletionToken>
+    auto async_connect(const std::string &username,
+                       const std::string &password,
+                       const std::string &account_id,
+                       CompletionToken &&token) {
+        return spawn(
+            start([=]() -> boost::asio::awaitable<web_detail> {
+                return authenticator::authenticate(username, password,
+                                                   account_id);
+            }),
+            std::forward<CompletionToken>(token));
+    }
+    template <typename CompletionToken>
+    auto async_connect(CompletionToken &&token) {
+        return spawn(
+            start([]() -> boost::asio::awaitable<web_detail> {
+                return authenticator::authenticate();
+            }),
+            std::forward<CompletionToken>(token));
+    }
+
+    // Connect with a session authenticated elsewhere, skipping the login.
+    template <typename CompletionToken>
+    auto async_connect(web_detail detail, CompletionToken &&token) {
+        return spawn(
+            start([detail]() -> boost::asio::awaitable<web_detail> {
+                co_return detail;
+            }),
+            std::forward<CompletionToken>(token));
+    }
+
+    // Closes the feed, stops keeping the order connection warm and waits
+    // for orders in flight, so nothing still running refers to this
+    // object. Blocks until done, so not from the executor's own thread;
+    // the executor must keep running until it returns.
+    void stop();
+    // The same without blocking. Completion signature is
+    // void(std::exception_ptr).
+    template <typename CompletionToken>
+    auto async_stop(CompletionToken &&token) {
+        return boost::asio::co_spawn(tasks_strand_, stop_tasks(),
+                                     std::forward<CompletionToken>(token));
+    }
+    // Record every raw websocket frame to a capture file. Call before
+    // `connect`; see capture.h for replaying the file.
+    void capture(const std::string &path);
+
+    // Persist every tick to compressed per-quote, per-day segments under
+    // `directory`; see tick_store.h for reading them back. Call before
+    // `connect`.
+    void record_ticks(const std::string &directory,
+                      const tick_store_options &opts = {});
+
+    // Socket tuning, busy polling and CPU pinning for the io thread. Call
+    // before `connect`.
+    void set_network_profile(const network_profile &profile);
+
+    // Wake-up-to-read latency of the busy-poll loop, see net_profile.h.
+    wakeup_stats wakeup_latency() const { return wakeups_.stats(); }
+
+    // TLS handshakes made so far and how many resumed a cached session,
+    // see tls.h.
+    tls_stats tls_resumption() const { return read_tls_stats(); }
+
+    // Sampled is the cheapest stream; use grouping::grouped for the
+    // unsampled feed on latency-critical instruments.
+    void subscribe(int quote_id, grouping g = grouping::sampled);
+    void unsubscribe(int quote_id, grouping g = grouping::sampled);
+
+    // Lock-free last bid/ask per quote, safe to read from any thread.
+    const quote_cache &quotes() const { return ws_client_.quotes(); }
+
+    // Bid/ask/mid/high/low/timestamp columns across all quotes; hold the
+    // snapshot only for the duration of a scan.
+    quote_table::snapshot snapshot() const {
+        return ws_client_.table().acquire();
+    }
+
+    // Keep the last `capacity` ticks of up to `max_quotes` quotes for
+    // lookback queries. Memory is allocated here, once. Call before
+    // `connect`.
+    void enable_tick_history(std::size_t capacity = 4096,
+                             std::size_t max_quotes = 64);
+    const tick_history &history() const;
+
+    // The blocking calls below wait for the io thread; each has an
+    // async_ twin taking any asio completion token (use_awaitable,
+    // use_future, deferred or a callback) so many requests can be in
+    // flight at once. Completion signature is
+    // void(std::exception_ptr, result), or void(std::exception_ptr).
 
     std::vector<market_group> get_market_super_group();
     std::vector<market_group> get_market_group(int id);
     std::vector<market> get_market_quote(int id);
     market_details_response get_market_details(int id);
-    void trade(const trade_request &&request);
+
+    template <typename CompletionToken>
+    auto async_get_market_super_group(CompletionToken &&token) {
+        return spawn(rest_client_.get_market_super_group(),
+                     std::forward<CompletionToken>(token));
+    }
+    template <typename CompletionToken>
+    auto async_get_market_group(int id, CompletionToken &&token) {
+        return spawn(rest_client_.get_market_group(id),
+                     std::forward<CompletionToken>(token));
+    }
+    template <typename CompletionToken>
+    auto async_get_market_quote(int id, CompletionToken &&token) {
+        return spawn(rest_client_.get_market_quote(id),
+                     std::forward<CompletionToken>(token));
+    }
+    template <typename CompletionToken>
+    auto async_get_market_details(int id, CompletionToken &&token) {
+        return spawn(rest_client_.get_market_details(id),
+                     std::forward<CompletionToken>(token));
+    }
+    template <typename CompletionToken>
+    auto async_subscribe(int quote_id, grouping g, CompletionToken &&token) {
+        return spawn(ws_client_.subscribe(quote_id, g),
+                     std::forward<CompletionToken>(token));
+    }
+    template <typename CompletionToken>
+    auto async_unsubscribe(int quote_id, grouping g, CompletionToken &&token) {
+        return spawn(ws_client_.unsubscribe(quote_id, g),
+                     std::forward<CompletionToken>(token));
+    }
+
+    // Place an order without waiting for it; the response goes to
+    // `trade_response_cb`. An empty `key` is taken from the quote's latest
+    // tick. Returns the id of the order's trace. Throws after stop().
+    std::uint64_t trade(const trade_request &&request);
+    // Traces of the orders finished since the last call, oldest first; see
+    // order_trace.h. Safe to call from any thread.
+    std::vector<order_trace> drain_order_traces();
+    // See order_options; order_options::fast() skips the simulate step and
+    // reuses market details between orders.
+    void set_order_options(const order_options &opts);
+    // Keep backfilled candles under `directory` so later backfills, also
+    // across restarts, only download what is new.
+    void cache_candles(const std::string &directory);
     std::vector<candle> backfill(int market_id, int quote_id, size_t sz,
                                  chart_duration dur);
 
-  private:
-    template <typename Awaitable>
-    auto run_awaitable(Awaitable awaitable) -> typename Awaitable::value_type;
+    // Backfill many markets at once over up to `concurrency` chart-host
+    // connections. `on_result` runs on the io thread as each market
+    // completes; returns once all have.
+    void backfill(std::vector<backfill_request> requests,
+                  std::function<void(backfill_result &&)> on_result,
+                  size_t concurrency = 8);
 
-    auto run_awaitable(boost::asio::awaitable<void>) -> void;
+    template <typename CompletionToken>
+    auto async_backfill(int market_id, int quote_id, size_t sz,
+                        chart_duration dur, CompletionToken &&token) {
+        return spawn(rest_client_.backfill(market_id, quote_id, sz, dur),
+                     std::forward<CompletionToken>(token));
+    }
+    template <typename CompletionToken>
+    auto async_backfill(std::vector<backfill_request> requests,
+                        std::function<void(backfill_result &&)> on_result,
+                        size_t concurrency, CompletionToken &&token) {
+        return spawn(rest_client_.backfill(std::move(requests), concurrency,
+                                           std::move(on_result)),
+                     std::forward<CompletionToken>(token));
+    }
 
+  private:
     user_callbacks callbacks_;
-    boost::asio::io_context io_context_;
+    // only when no executor was given, run by io_thread_
+    std::unique_ptr<boost::asio::io_context> io_context_;
+    boost::asio::any_io_executor executor_;
     std::thread io_thread_;
+    network_profile profile_;
+    wakeup_recorder wakeups_; // sampled by io_thread_'s busy-poll loop
 
     rest_api rest_client_;
     ws_client ws_client_;
 
     std::atomic<bool> shutdown_{false};
-
-    std::promise<void> connect_p_;
-    std::future<void> connect_f_;
+    // detached coroutines that use `this`, see spawn(). Their completions
+    // and stop_tasks run on tasks_strand_, so the last task is done with
+    // `this` before stop_tasks can see the count reach zero.
+    std::atomic<std::size_t> tasks_{0};
+    boost::asio::strand<boost::asio::any_io_executor> tasks_strand_;
+    boost::asio::steady_timer tasks_done_;
+    std::atomic<std::uint64_t> next_order_id_{0};
+    order_trace_log traces_;
 
     void connect(std::function<boost::asio::awaitable<web_detail>()> f);
+    // authenticate, log in over REST, then start the feed and wait for it
+    // to authenticate
+    boost::asio::awaitable<void>
+    start(std::function<boost::asio::awaitable<web_detail>()> auth_fn);
+    boost::asio::awaitable<void> run_feed(boost::urls::url sock_host,
+                                          std::string login_id,
+                                          std::string token);
 
     void start_io_thread();
+    // the order's coroutine, see trade()
+    boost::asio::awaitable<void> place(trade_request order, order_trace trace);
+    // co_spawn `task` detached, counted in tasks_ until it completes
+    void spawn(boost::asio::awaitable<void> task);
+
+    // The same, completing with `token`; every async_ call goes through
+    // here so stop_tasks waits for requests still in flight. The task is
+    // counted when the operation is initiated, not when it is created, so
+    // a deferred operation that is never started leaves no count behind.
+    // Once stopped, new operations fail instead of running.
+    template <typename T, typename CompletionToken>
+    auto spawn(boost::asio::awaitable<T> task, CompletionToken &&token) {
+        using signature =
+            std::conditional_t<std::is_void_v<T>, void(std::exception_ptr),
+                               void(std::exception_ptr, T)>;
+        return boost::asio::async_initiate<CompletionToken, signature>(
+            [this](auto handler, boost::asio::awaitable<T> task) {
+                // counted before checking shutdown_, which stop_tasks sets
+                // before checking the count, so one of us sees the other
+                ++tasks_;
+                if (shutdown_) {
+                    task_done();
+                    // fails with "stopped" without running `task`
+                    boost::asio::co_spawn(
+                        executor_,
+                        []() -> boost::asio::awaitable<T> {
+                            throw fail("td365: stopped");
+                        },
+                        std::move(handler));
+                    return;
+                }
+                boost::asio::co_spawn(executor_, counted(std::move(task)),
+                                      std::move(handler));
+            },
+            token, std::move(task));
+    }
+
+    // Runs `task`, then uncounts it. Not RAII: a task destroyed unrun,
+    // with its executor, must not touch an object that may be gone.
+    template <typename T>
+    boost::asio::awaitable<T> counted(boost::asio::awaitable<T> task) {
+        std::exception_ptr error;
+        if constexpr (std::is_void_v<T>) {
+            try {
+                co_await std::move(task);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            task_done();
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        } else {
+            std::optional<T> rv;
+            try {
+                rv.emplace(co_await std::move(task));
+            } catch (...) {
+                error = std::current_exception();
+            }
+            task_done();
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            co_return std::move(*rv);
+        }
+    }
+    void task_done();
+    boost::asio::awaitable<void> stop_tasks();
 };
 } // namespace td365
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <td365/types.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace td365 {
+
+struct tick_sample {
+    tick::time_type timestamp;
+    double bid;
+    double ask;
+    double mid_price;
+};
+
+// The last `capacity` ticks of up to `max_quotes` quotes, allocated up front.
+// Each quote is a columnar ring ordered by server timestamp. One thread
+// records; any thread may look up. Readers that fall more than `capacity`
+// ticks behind the writer lose the overwritten samples, never see torn ones.
+class tick_history {
+  public:
+    explicit tick_history(std::size_t capacity = 4096,
+                          std::size_t max_quotes = 64);
+
+    // Writer thread only. Ticks older than the newest recorded one for the
+    // quote, and quotes beyond `max_quotes`, are dropped.
+    void record(const tick &t);
+
+    // Latest sample at or before `t`.
+    std::optional<tick_sample> at(int quote_id, tick::time_type t) const;
+
+    // Call `f(const tick_sample &)` for each sample in [from, to), oldest
+    // first. Returns the number of samples visited.
+    template <typename F>
+    std::size_t for_each(int quote_id, tick::time_type from,
+                         tick::time_type to, F &&f) const {
+        const auto *r = find(quote_id);
+        if (r == nullptr) {
+            return 0;
+        }
+        std::size_t n = 0;
+        auto i = lower_bound(*r, to_ns(from));
+        for (;;) {
+            tick_sample s;
+            if (!load(*r, i, s)) {
+                if (i >= r->count.load(std::memory_order_acquire)) {
+                    break; // past the newest sample
+                }
+                // overwritten while we were iterating; skip to the oldest
+                // sample still held, or retry `i` if it was not lapped
+                const auto begin = r->begin.load(std::memory_order_acquire);
+                if (begin > i + capacity_) {
+                    i = std::max(i + 1, begin - capacity_);
+                }
+                continue;
+            }
+            if (s.timestamp >= to) {
+                break;
+            }
+            f(std::as_const(s));
+            ++n;
+            ++i;
+        }
+        return n;
+    }
+
+    // Samples currently held for `quote_id`.
+    std::size_t size(int quote_id) const;
+
+    std::size_t capacity() const { return capacity_; }
+
+  private:
+    struct ring {
+        // total samples ever recorded; sample i lives at i % capacity
+        std::atomic<std::uint64_t> count{0};
+        // samples whose write has started, ahead of `count` during a write
+        std::atomic<std::uint64_t> begin{0};
+        std::unique_ptr<std::atomic<std::int64_t>[]> timestamp;
+        std::unique_ptr<std::atomic<double>[]> bid;
+        std::unique_ptr<std::atomic<double>[]> ask;
+        std::unique_ptr<std::atomic<double>[]> mid_price;
+    };
+
+    static std::int64_t to_ns(tick::time_type t) {
+        return t.time_since_epoch().count();
+    }
+
+    const ring *find(int quote_id) const;
+    ring *find_or_insert(int quote_id);
+
+    // Reads sample `i`; false if it is not (or no longer) held.
+    bool load(const ring &r, std::uint64_t i, tick_sample &out) const;
+
+    // Index of the first held sample with timestamp >= ns.
+    std::uint64_t lower_bound(const ring &r, std::int64_t ns) const;
+
+    // open-addressed quote id -> ring, sized at twice max_quotes
+    struct index_entry {
+        std::atomic<int> quote_id{0}; // 0 = free
+        std::atomic<ring *> r{nullptr};
+    };
+
+    std::size_t capacity_;
+    std::size_t max_quotes_;
+    std::size_t used_ = 0;
+    std::unique_ptr<ring[]> rings_;
+    std::size_t mask_;
+    std::unique_ptr<index_entry[]> index_;
+    bool full_warned_ = false;
+};
+
+} // namespace td365
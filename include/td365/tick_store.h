@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <td365/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace td365 {
+
+struct tick_store_options {
+    // keep the per-tick hash; it is most of the size of a stored tick
+    bool store_hash = false;
+    // ticks per compressed block, the unit the writer appends
+    std::size_t block_ticks = 1024;
+    // ticks buffered between the feed thread and the writer thread
+    std::size_t queue_capacity = 65536;
+    // partially filled blocks are written at least this often
+    std::chrono::milliseconds flush_interval{1000};
+};
+
+// One tick as read back from a segment. `hash` points into the reader's
+// mapping and is empty unless the store kept hashes.
+struct stored_tick {
+    int quote_id;
+    tick::time_type timestamp;
+    tick::time_type received;
+    double bid;
+    double ask;
+    double daily_change;
+    double high;
+    double low;
+    double mid_price;
+    direction dir;
+    bool tradable;
+    bool call_only;
+    int field13;
+    grouping group;
+    std::string_view hash;
+};
+
+// Appends ticks to `<directory>/<quote_id>/<YYYY-MM-DD>.ticks`, one segment
+// per quote per UTC day of the server timestamp. A segment is a sequence of
+// blocks, each holding its ticks column by column: timestamps as
+// delta-of-delta, prices as zigzag varint deltas of scaled integers. Blocks
+// are appended whole, so a crash loses at most the unwritten blocks.
+//
+// `append` is called on the feed thread and only copies the tick into a
+// fixed queue; encoding and file I/O happen on the store's own thread.
+class tick_store {
+  public:
+    explicit tick_store(std::string directory, tick_store_options opts = {});
+    ~tick_store();
+
+    tick_store(const tick_store &) = delete;
+    tick_store &operator=(const tick_store &) = delete;
+
+    // Feed thread only. Never blocks; returns false and counts the tick as
+    // dropped if the writer has fallen `queue_capacity` ticks behind.
+    bool append(const tick &t);
+
+    std::uint64_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    static std::string segment_path(const std::string &directory,
+                                    int quote_id, tick::time_type day);
+
+    struct record; // queued tick, defined in tick_store.cpp
+    struct segment;
+
+  private:
+    void run();
+
+    std::string directory_;
+    tick_store_options opts_;
+    std::unique_ptr<record[]> queue_;
+    std::size_t mask_;
+    alignas(64) std::atomic<std::uint64_t> head_{0}; // next to consume
+    alignas(64) std::atomic<std::uint64_t> tail_{0}; // next to produce
+    std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<bool> stop_{false};
+    std::thread writer_;
+};
+
+// Memory-mapped, read-only view of one segment file. Ticks are decoded
+// straight from the mapping as `next` walks it; nothing is copied.
+class tick_segment_reader {
+  public:
+    explicit tick_segment_reader(const std::string &path);
+    ~tick_segment_reader();
+
+    tick_segment_reader(const tick_segment_reader &) = delete;
+    tick_segment_reader &operator=(const tick_segment_reader &) = delete;
+
+    int quote_id() const { return quote_id_; }
+
+    // False at the end of the segment or at a torn final block.
+    bool next(stored_tick &out);
+
+    void rewind();
+
+  private:
+    bool open_block();
+
+    static constexpr std::size_t columns = 11;
+
+    int fd_ = -1;
+    const std::uint8_t *base_ = nullptr;
+    std::size_t size_ = 0;
+    int quote_id_ = 0;
+
+    // current block
+    std::size_t block_end_ = 0;
+    std::uint32_t remaining_ = 0;
+    double scale_ = 1;
+    bool has_hash_ = false;
+    const std::uint8_t *col_[columns] = {};
+
+    // running values the column deltas apply to
+    std::int64_t ts_ = 0;
+    std::int64_t delta_ = 0;
+    bool first_ = true;
+    std::int64_t bid_ = 0, mid_ = 0, high_ = 0, low_ = 0, change_ = 0;
+    std::int64_t field13_ = 0;
+};
+
+} // namespace td365
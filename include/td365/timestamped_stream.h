@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <boost/asio/compose.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast/core/role.hpp>
+#include <boost/beast/core/tcp_stream.hpp>
+#include <boost/beast/websocket/teardown.hpp>
+#include <chrono>
+#include <sys/uio.h>
+
+namespace td365 {
+
+// Wraps a tcp_stream so reads go through recvmsg(2) and pick up the kernel
+// receive timestamp (SO_TIMESTAMPNS) of the data just read. Until
+// `enable_timestamps` succeeds every operation is forwarded unchanged, which
+// keeps tcp_stream's timeouts in effect for connect and handshakes. After
+// that, reads wait on the raw socket where tcp_stream's timer can't see
+// them; set timeouts with `expires_after` here, not on the tcp_stream.
+class timestamped_stream {
+  public:
+    using time_type = std::chrono::time_point<std::chrono::system_clock,
+                                              std::chrono::nanoseconds>;
+    using next_layer_type = boost::beast::tcp_stream;
+    using lowest_layer_type = next_layer_type::socket_type;
+    using executor_type = next_layer_type::executor_type;
+
+    template <typename... Args>
+    explicit timestamped_stream(Args &&...args)
+        : stream_(std::forward<Args>(args)...),
+          timer_(stream_.get_executor()) {}
+
+    executor_type get_executor() noexcept { return stream_.get_executor(); }
+
+    next_layer_type &next_layer() noexcept { return stream_; }
+    const next_layer_type &next_layer() const noexcept { return stream_; }
+
+    lowest_layer_type &lowest_layer() noexcept { return stream_.socket(); }
+    const lowest_layer_type &lowest_layer() const noexcept {
+        return stream_.socket();
+    }
+
+    // Turn on SO_TIMESTAMPNS for the connected socket. Returns false if the
+    // kernel refused, in which case reads keep going through tcp_stream.
+    bool enable_timestamps();
+
+    bool timestamps_enabled() const noexcept { return timestamps_; }
+
+    // tcp_stream's expires_after, and with timestamps enabled also closes
+    // the socket when `timeout` runs out, which ends a read waiting on it.
+    void expires_after(std::chrono::steady_clock::duration timeout);
+
+    // Kernel arrival time of the last segment consumed by the most recent
+    // read. Only meaningful once timestamps are enabled.
+    time_type last_received() const noexcept { return last_received_; }
+
+    template <typename ConstBufferSequence, typename WriteToken>
+    auto async_write_some(const ConstBufferSequence &buffers,
+                          WriteToken &&token) {
+        return stream_.async_write_some(buffers,
+                                        std::forward<WriteToken>(token));
+    }
+
+    template <typename MutableBufferSequence, typename ReadToken>
+    auto async_read_some(const MutableBufferSequence &buffers,
+                         ReadToken &&token) {
+        return boost::asio::async_compose<ReadToken,
+                                          void(boost::system::error_code,
+                                               std::size_t)>(
+            read_op<MutableBufferSequence>{*this, buffers}, token, stream_);
+    }
+
+  private:
+    static constexpr std::size_t max_iov = 16;
+
+    // Non-blocking recvmsg into `iov`. Sets `ec` to would_block when there
+    // is nothing to read yet.
+    std::size_t receive(iovec *iov, std::size_t count,
+                        boost::system::error_code &ec);
+
+    template <typename MutableBufferSequence> struct read_op {
+        timestamped_stream &stream;
+        MutableBufferSequence buffers;
+        std::size_t bytes = 0;
+        bool initiated = false;
+        bool done = false;
+
+        template <typename Self>
+        void operator()(Self &self, boost::system::error_code ec = {}) {
+            if (done) {
+                self.complete(ec, bytes);
+                return;
+            }
+            if (!stream.timestamps_) {
+                stream.stream_.async_read_some(buffers, std::move(self));
+                return;
+            }
+            const bool continuation = initiated;
+            initiated = true;
+            if (!ec) {
+                iovec iov[max_iov];
+                std::size_t count = 0;
+                for (auto it = boost::asio::buffer_sequence_begin(buffers);
+                     it != boost::asio::buffer_sequence_end(buffers) &&
+                     count < max_iov;
+                     ++it) {
+                    boost::asio::mutable_buffer b(*it);
+                    iov[count].iov_base = b.data();
+                    iov[count].iov_len = b.size();
+                    ++count;
+                }
+                bytes = stream.receive(iov, count, ec);
+                if (ec == boost::asio::error::would_block) {
+                    stream.stream_.socket().async_wait(
+                        boost::asio::socket_base::wait_read, std::move(self));
+                    return;
+                }
+            }
+            if (continuation) {
+                self.complete(ec, bytes);
+                return;
+            }
+            // never complete from inside the initiating function
+            done = true;
+            boost::asio::post(stream.stream_.get_executor(),
+                              [self = std::move(self), ec]() mutable {
+                                  self(ec);
+                              });
+        }
+
+        // completion of a forwarded tcp_stream read
+        template <typename Self>
+        void operator()(Self &self, boost::system::error_code ec,
+                        std::size_t n) {
+            self.complete(ec, n);
+        }
+    };
+
+    next_layer_type stream_;
+    boost::asio::steady_timer timer_;
+    bool timestamps_ = false;
+    time_type last_received_{};
+};
+
+void teardown(boost::beast::role_type role, timestamped_stream &stream,
+              boost::system::error_code &ec);
+
+template <typename TeardownHandler>
+void async_teardown(boost::beast::role_type role, timestamped_stream &stream,
+                    TeardownHandler &&handler) {
+    using boost::beast::websocket::async_teardown;
+    async_teardown(role, stream.next_layer(),
+                   std::forward<TeardownHandler>(handler));
+}
+
+} // namespace td365
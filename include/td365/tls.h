@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <openssl/ssl.h>
+#include <string>
+
+namespace td365 {
+
+// Client-side TLS session cache shared by every connection made with
+// ssl_ctx(). The latest session (ID or ticket) is kept per SNI host name,
+// so a feed reconnect or a new REST connection can resume it with an
+// abbreviated handshake.
+
+struct tls_stats {
+    std::uint64_t handshakes = 0; // completed client handshakes
+    std::uint64_t resumed = 0;    // of those, how many resumed a session
+};
+
+// Collect new sessions from `ctx`; ssl_ctx() does this.
+void enable_tls_session_cache(SSL_CTX *ctx);
+
+// Offer the cached session for `host`, if there is a usable one. Call
+// between setting SNI and the handshake.
+void offer_tls_session(SSL *ssl, const std::string &host);
+
+// Called after each client handshake completes.
+void record_tls_handshake(SSL *ssl);
+
+tls_stats read_tls_stats();
+
+} // namespace td365
@@ -93,6 +93,17 @@ struct tick {
     grouping group;
     std::chrono::nanoseconds latency{}; // difference between received timestamp
     // and timestamp sent by server
+    time_type received{}; // kernel arrival time of the frame (SO_TIMESTAMPNS)
+    time_type decoded{};  // when parsing of this tick finished
+
+    // received - timestamp: server to our network stack
+    std::chrono::nanoseconds network_latency() const {
+        return received - timestamp;
+    }
+    // decoded - received: time spent inside the process
+    std::chrono::nanoseconds process_latency() const {
+        return decoded - received;
+    }
 };
 
 struct trade_request {
@@ -105,6 +116,8 @@ struct trade_request {
     double stake;
     double stop;
     double limit;
+    // hash of the tick `price` came from; td365::trade fills in the quote's
+    // latest one when left empty
     std::string key;
 };
 
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <td365/http_client.h>
+#include <td365/resolver.h>
 #include "nlohmann/json_fwd.hpp"
 #include <td365/verify.h>
 
@@ -25,6 +26,8 @@ namespace td365 {
 
     std::string get_http_body(http_response const &res);
 
-    boost::asio::awaitable<boost::asio::ip::tcp::resolver::results_type>
-    td_resolve(std::string_view host, std::string_view port);
+    // As above, but without copying: an uncompressed body is returned in
+    // place and a gzip body is decoded into `buffer`, whose capacity is
+    // reused from call to call. The view is valid while both are.
+    std::string_view get_http_body(http_response const &res, std::string &buffer);
 } // namespace td365
@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <td365/net_profile.h>
+#include <td365/timestamped_stream.h>
+
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
 #include <boost/beast.hpp>
@@ -17,13 +20,13 @@
 
 namespace td365 {
 using ssl_websocket_type = boost::beast::websocket::stream<
-    boost::beast::ssl_stream<boost::beast::tcp_stream>>;
+    boost::beast::ssl_stream<timestamped_stream>>;
 using plain_websocket_type =
-    boost::beast::websocket::stream<boost::beast::tcp_stream>;
+    boost::beast::websocket::stream<timestamped_stream>;
 
 class ws {
   public:
-    explicit ws();
+    explicit ws(const socket_options &sockets = {});
 
     boost::asio::awaitable<void> connect(boost::urls::url);
 
@@ -34,9 +37,18 @@ class ws {
     boost::asio::awaitable<std::pair<boost::system::error_code, std::string>>
     read_message();
 
+    // Arrival time of the message returned by the last `read_message`: the
+    // kernel receive timestamp when SO_TIMESTAMPNS is available, otherwise
+    // the time the read completed.
+    timestamped_stream::time_type last_received() const { return received_; }
+
   private:
+    timestamped_stream &transport();
+
     std::unique_ptr<ssl_websocket_type> ssl_ws_;
     std::unique_ptr<plain_websocket_type> plain_ws_;
     bool using_ssl_;
+    socket_options sockets_;
+    timestamped_stream::time_type received_{};
 };
 } // namespace td365
@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <td365/quote_cache.h>
+#include <td365/quote_table.h>
+#include <td365/tick_history.h>
 #include <td365/types.h>
 #include <td365/ws.h>
 
@@ -17,11 +20,17 @@
 #include <chrono>
 #include <future>
 #include <nlohmann/json_fwd.hpp>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace td365 {
 
+class capture_writer;
+class tick_store;
+enum class payload_type;
+
 class ws_client {
   public:
     explicit ws_client(const user_callbacks &);
@@ -36,19 +45,62 @@ class ws_client {
 
     boost::asio::awaitable<void> send(const nlohmann::json &);
 
-    boost::asio::awaitable<void> subscribe(int quote_id);
+    // Each (quote, grouping) pair is a separate stream; a quote may be
+    // subscribed with several groupings at once.
+    boost::asio::awaitable<void> subscribe(int quote_id,
+                                           grouping g = grouping::sampled);
 
-    boost::asio::awaitable<void> unsubscribe(int quote_id);
+    boost::asio::awaitable<void> unsubscribe(int quote_id,
+                                             grouping g = grouping::sampled);
 
+    // Blocks until the feed has authenticated; for threads other than the
+    // one running the client.
     void wait_for_auth();
 
+    // The same, for coroutines on the client's own executor. Throws if `run`
+    // returns before authenticating.
+    boost::asio::awaitable<void> authenticated();
+
+    // Top of book for every quote seen, updated before `tick_cb` runs.
+    const quote_cache &quotes() const { return quotes_; }
+
+    // Columnar view of all quotes, published once per received frame.
+    const quote_table &table() const { return table_; }
+
+    // Hash of the latest tick per quote, which the server takes as the key
+    // of an order at that price. nullptr before the first tick. io thread
+    // only.
+    const std::string *order_key(int quote_id) const;
+
+    // Keep recent ticks per quote in `history`. Must be set before `run`.
+    void set_tick_history(std::unique_ptr<tick_history> history);
+    // Applied to the feed's socket from the next connect on.
+    void set_socket_options(const socket_options &opts) { sockets_ = opts; }
+    const tick_history *history() const { return history_.get(); }
+
+    // Persist every tick to `store`. Must be set before `run`.
+    void set_tick_store(std::unique_ptr<tick_store> store);
+
+    // Record every received frame to `writer`. Must be set before `run`.
+    void set_capture(std::unique_ptr<capture_writer> writer);
+
+    // Dispatch a previously captured frame. Protocol frames (connect,
+    // authentication, heartbeat) are ignored since there is no connection.
+    // `received` is stamped on the resulting ticks as their arrival time.
+    void replay(std::string_view frame, tick::time_type received = {});
+
     boost::asio::awaitable<void> run(boost::urls::url_view url,
                                      const std::string &login_id,
                                      const std::string &token,
                                      std::atomic<bool> &shutdown);
 
+    // Close the feed's connection, ending a pending read in `run`; set its
+    // `shutdown` flag first so it does not reconnect.
+    boost::asio::awaitable<void> close();
+
   private:
-    void process_subscribe_response(const nlohmann::json &msg);
+    void process_subscribe_response(const nlohmann::json &msg,
+                                    tick::time_type received);
 
     boost::asio::awaitable<void>
     process_reconnect_response(const nlohmann::json &msg);
@@ -63,20 +115,43 @@ class ws_client {
     boost::asio::awaitable<void>
     process_authentication_response(const nlohmann::json &msg);
 
-    void process_price_data(const nlohmann::json &msg);
+    void process_message(payload_type type, const nlohmann::json &msg,
+                         tick::time_type received);
+    void process_price_data(const nlohmann::json &msg,
+                            tick::time_type received);
     void process_account_summary(const nlohmann::json &msg);
     void process_account_details(const nlohmann::json &msg);
+    void dispatch_tick(tick &&t, tick::time_type received);
 
     const user_callbacks &callbacks_;
     std::unique_ptr<ws> ws_;
+    socket_options sockets_;
+    std::unique_ptr<capture_writer> capture_;
+    quote_cache quotes_;
+    quote_table table_;
+    std::unique_ptr<tick_history> history_;
+    std::unique_ptr<tick_store> store_;
+
+    struct order_key_slot {
+        std::string hash;
+        tick::time_type timestamp{};
+    };
+    // keys keep their capacity, so updating one doesn't allocate
+    std::unordered_map<int, order_key_slot> order_keys_;
     std::string supported_version_ = "1.0.0.6";
 
     // Connection state tracking
     std::string connection_id_;
-    std::vector<int> subscribed_;
+    std::vector<std::pair<int, grouping>> subscribed_;
 
     std::promise<void> auth_p_;
     std::future<void> auth_f_;
+    bool authenticated_ = false;
+    bool stopped_ = false;
+    // wakes authenticated() when either flag changes
+    std::optional<boost::asio::steady_timer> auth_signal_;
+
+    void signal_auth();
 
     // Reconnection state
     boost::urls::url stored_url_;
@@ -0,0 +1,620 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/arrow_ipc.h>
+
+#include <td365/parsing.h>
+#include <td365/verify.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+// The IPC format is a handful of flatbuffer messages around raw column
+// buffers, so it is written here directly rather than through libarrow.
+// Message layouts follow format/Schema.fbs, Message.fbs and File.fbs of the
+// Arrow specification (metadata version V5).
+
+namespace td365 {
+namespace {
+// Minimal flatbuffer builder. Like the reference implementation it fills
+// the buffer back to front, so children are created before their parents
+// and offsets are tracked as distances from the end.
+class fb_builder {
+  public:
+    using ref = std::uint32_t;
+
+    std::size_t size() const { return buf_.size() - head_; }
+
+    void align(std::size_t a, std::size_t extra = 0) {
+        min_align_ = std::max(min_align_, a);
+        while ((size() + extra) % a != 0) {
+            prepend(nullptr, 1);
+        }
+    }
+
+    template <typename T> void push(T v) {
+        align(sizeof(T));
+        prepend(&v, sizeof(v));
+    }
+
+    ref string(std::string_view s) {
+        align(4, s.size() + 1);
+        prepend(nullptr, 1);
+        prepend(s.data(), s.size());
+        push(static_cast<std::uint32_t>(s.size()));
+        return static_cast<ref>(size());
+    }
+
+    ref offsets(std::span<const ref> refs) {
+        align(4, 4 * refs.size());
+        for (auto it = refs.rbegin(); it != refs.rend(); ++it) {
+            push_offset(*it);
+        }
+        push(static_cast<std::uint32_t>(refs.size()));
+        return static_cast<ref>(size());
+    }
+
+    // Vector of 8-byte aligned structs, already laid out in `bytes`.
+    ref structs(std::span<const std::uint8_t> bytes, std::size_t count) {
+        align(8, bytes.size());
+        prepend(bytes.data(), bytes.size());
+        push(static_cast<std::uint32_t>(count));
+        return static_cast<ref>(size());
+    }
+
+    void start_table() {
+        fields_.clear();
+        table_start_ = size();
+    }
+
+    template <typename T> void add(std::uint16_t id, T v) {
+        push(v);
+        fields_.emplace_back(id, size());
+    }
+
+    void add_offset(std::uint16_t id, ref r) {
+        push_offset(r);
+        fields_.emplace_back(id, size());
+    }
+
+    ref end_table() {
+        push(std::int32_t{0}); // soffset to the vtable, patched below
+        const auto table = size();
+
+        std::uint16_t n = 0;
+        for (auto [id, at] : fields_) {
+            n = std::max<std::uint16_t>(n, static_cast<std::uint16_t>(id + 1));
+        }
+        std::vector<std::uint16_t> vtable(2 + n, 0);
+        vtable[0] = static_cast<std::uint16_t>(2 * vtable.size());
+        vtable[1] = static_cast<std::uint16_t>(table - table_start_);
+        for (auto [id, at] : fields_) {
+            vtable[2 + id] = static_cast<std::uint16_t>(table - at);
+        }
+        for (auto it = vtable.rbegin(); it != vtable.rend(); ++it) {
+            push(*it);
+        }
+
+        // the vtable sits just before the table
+        const auto soffset = static_cast<std::int32_t>(size() - table);
+        std::memcpy(&buf_[buf_.size() - table], &soffset, sizeof(soffset));
+        return static_cast<ref>(table);
+    }
+
+    std::span<const std::uint8_t> finish(ref root) {
+        align(min_align_, 4);
+        push_offset(root);
+        return {buf_.data() + head_, size()};
+    }
+
+  private:
+    void push_offset(ref r) {
+        align(4);
+        push(static_cast<std::uint32_t>(size() + 4 - r));
+    }
+
+    void prepend(const void *p, std::size_t n) {
+        if (head_ < n) {
+            const auto used = size();
+            std::vector<std::uint8_t> bigger(std::max(buf_.size() * 2,
+                                                      used + n + 256));
+            std::memcpy(bigger.data() + bigger.size() - used,
+                        buf_.data() + head_, used);
+            head_ = bigger.size() - used;
+            buf_ = std::move(bigger);
+        }
+        head_ -= n;
+        if (p != nullptr) {
+            std::memcpy(&buf_[head_], p, n);
+        } else {
+            std::memset(&buf_[head_], 0, n);
+        }
+    }
+
+    std::vector<std::uint8_t> buf_ = std::vector<std::uint8_t>(1024);
+    std::size_t head_ = 1024;
+    std::size_t min_align_ = 8;
+    std::size_t table_start_ = 0;
+    std::vector<std::pair<std::uint16_t, std::size_t>> fields_;
+};
+
+// Schema.fbs / Message.fbs enum values
+constexpr std::int16_t metadata_v5 = 4;
+constexpr std::uint8_t header_schema = 1;
+constexpr std::uint8_t header_record_batch = 3;
+constexpr std::uint8_t type_int = 2;
+constexpr std::uint8_t type_floating_point = 3;
+constexpr std::uint8_t type_utf8 = 5;
+constexpr std::uint8_t type_bool = 6;
+constexpr std::uint8_t type_timestamp = 10;
+constexpr std::uint8_t type_duration = 18;
+constexpr std::int16_t precision_double = 2;
+constexpr std::int16_t unit_nanosecond = 3;
+
+constexpr char file_magic[8] = {'A', 'R', 'R', 'O', 'W', '1', 0, 0};
+constexpr std::uint32_t continuation = 0xFFFFFFFF;
+
+// FieldNode and Buffer are both structs of two int64s.
+void put_pair(std::vector<std::uint8_t> &out, std::int64_t a, std::int64_t b) {
+    const auto at = out.size();
+    out.resize(at + 16);
+    std::memcpy(&out[at], &a, 8);
+    std::memcpy(&out[at + 8], &b, 8);
+}
+
+std::int64_t to_ns(tick::time_type t) { return t.time_since_epoch().count(); }
+} // namespace
+
+namespace detail {
+enum class column_type { int32, float64, boolean, utf8, timestamp, duration };
+
+struct column_spec {
+    const char *name;
+    column_type type;
+};
+
+class arrow_ipc {
+  public:
+    arrow_ipc(const std::string &path, arrow_format format,
+              std::size_t batch_rows, std::initializer_list<column_spec> specs)
+        : format_(format), batch_rows_(batch_rows) {
+        verify(batch_rows_ > 0, "arrow writer: batch_rows must be positive");
+        for (const auto &s : specs) {
+            columns_.emplace_back().spec = s;
+        }
+
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        verify(fd_ >= 0, "arrow writer: open {}: {}", path,
+               std::strerror(errno));
+        if (format_ == arrow_format::file) {
+            write_bytes(file_magic, sizeof(file_magic));
+        }
+        fb_builder fb;
+        const auto schema = build_schema(fb);
+        write_message(fb, header_schema, schema, {});
+    }
+
+    ~arrow_ipc() {
+        try {
+            close();
+        } catch (const std::exception &e) {
+            spdlog::error("arrow writer: {}", e.what());
+        }
+    }
+
+    template <typename T> void put(std::size_t col, T v) {
+        auto &c = columns_[col];
+        const auto at = c.values.size();
+        c.values.resize(at + sizeof(v));
+        std::memcpy(&c.values[at], &v, sizeof(v));
+        c.valid.push_back(1);
+    }
+
+    void put(std::size_t col, bool v) {
+        columns_[col].values.push_back(v ? 1 : 0);
+        columns_[col].valid.push_back(1);
+    }
+
+    void put(std::size_t col, std::string_view s) {
+        auto &c = columns_[col];
+        c.values.insert(c.values.end(), s.begin(), s.end());
+        c.offsets.push_back(static_cast<std::int32_t>(c.values.size()));
+        c.valid.push_back(1);
+    }
+
+    // Null in a fixed width column of `width` bytes.
+    void put_null(std::size_t col, std::size_t width) {
+        auto &c = columns_[col];
+        c.values.resize(c.values.size() + width);
+        c.valid.push_back(0);
+        ++c.nulls;
+    }
+
+    void end_row() {
+        if (++rows_ == batch_rows_) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (rows_ == 0 || fd_ < 0) {
+            return;
+        }
+
+        std::vector<std::uint8_t> body, nodes, buffers;
+        auto add_buffer = [&](const void *p, std::size_t n) {
+            put_pair(buffers, static_cast<std::int64_t>(body.size()),
+                     static_cast<std::int64_t>(n));
+            const auto *b = static_cast<const std::uint8_t *>(p);
+            body.insert(body.end(), b, b + n);
+            body.resize((body.size() + 7) & ~std::size_t{7});
+        };
+        auto add_bits = [&](const std::vector<std::uint8_t> &bytes) {
+            std::vector<std::uint8_t> bits((bytes.size() + 7) / 8);
+            for (std::size_t i = 0; i < bytes.size(); ++i) {
+                bits[i / 8] |= static_cast<std::uint8_t>(bytes[i] << (i % 8));
+            }
+            add_buffer(bits.data(), bits.size());
+        };
+
+        for (auto &c : columns_) {
+            put_pair(nodes, static_cast<std::int64_t>(rows_),
+                     static_cast<std::int64_t>(c.nulls));
+            if (c.nulls > 0) {
+                add_bits(c.valid);
+            } else {
+                add_buffer(nullptr, 0);
+            }
+            switch (c.spec.type) {
+            case column_type::utf8:
+                add_buffer(c.offsets.data(),
+                           c.offsets.size() * sizeof(std::int32_t));
+                add_buffer(c.values.data(), c.values.size());
+                break;
+            case column_type::boolean:
+                add_bits(c.values);
+                break;
+            default:
+                add_buffer(c.values.data(), c.values.size());
+            }
+            c.values.clear();
+            c.valid.clear();
+            c.offsets.assign(1, 0);
+            c.nulls = 0;
+        }
+
+        fb_builder fb;
+        const auto nodes_ref = fb.structs(nodes, columns_.size());
+        const auto buffers_ref = fb.structs(buffers, buffers.size() / 16);
+        fb.start_table();
+        fb.add(0, static_cast<std::int64_t>(rows_));
+        fb.add_offset(1, nodes_ref);
+        fb.add_offset(2, buffers_ref);
+        const auto batch = fb.end_table();
+
+        const auto offset = file_pos_;
+        const auto meta = write_message(fb, header_record_batch, batch, body);
+        blocks_.push_back({offset, meta, body.size()});
+        rows_ = 0;
+    }
+
+    void close() {
+        if (fd_ < 0) {
+            return;
+        }
+        flush();
+        const std::uint32_t eos[2] = {continuation, 0};
+        write_bytes(eos, sizeof(eos));
+
+        if (format_ == arrow_format::file) {
+            fb_builder fb;
+            const auto schema = build_schema(fb);
+            // Block is {int64 offset, int32 metaDataLength, int64
+            // bodyLength}, padded to 24 bytes
+            std::vector<std::uint8_t> blocks(blocks_.size() * 24);
+            for (std::size_t i = 0; i < blocks_.size(); ++i) {
+                const auto offset = static_cast<std::int64_t>(blocks_[i].offset);
+                const auto meta = static_cast<std::int32_t>(blocks_[i].meta);
+                const auto body = static_cast<std::int64_t>(blocks_[i].body);
+                std::memcpy(&blocks[i * 24], &offset, 8);
+                std::memcpy(&blocks[i * 24 + 8], &meta, 4);
+                std::memcpy(&blocks[i * 24 + 16], &body, 8);
+            }
+            const auto dictionaries = fb.structs({}, 0);
+            const auto batches = fb.structs(blocks, blocks_.size());
+            fb.start_table();
+            fb.add(0, metadata_v5);
+            fb.add_offset(1, schema);
+            fb.add_offset(2, dictionaries);
+            fb.add_offset(3, batches);
+            const auto footer = fb.finish(fb.end_table());
+            write_bytes(footer.data(), footer.size());
+            const auto len = static_cast<std::int32_t>(footer.size());
+            write_bytes(&len, sizeof(len));
+            write_bytes(file_magic, 6);
+        }
+
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+  private:
+    struct column {
+        column_spec spec;
+        std::vector<std::uint8_t> values;
+        std::vector<std::uint8_t> valid;
+        std::vector<std::int32_t> offsets{0};
+        std::size_t nulls = 0;
+    };
+
+    struct block {
+        std::size_t offset;
+        std::size_t meta;
+        std::size_t body;
+    };
+
+    fb_builder::ref build_schema(fb_builder &fb) const {
+        std::vector<fb_builder::ref> fields;
+        for (const auto &c : columns_) {
+            const auto name = fb.string(c.spec.name);
+            const auto children = fb.offsets({});
+            const auto tz = c.spec.type == column_type::timestamp
+                                ? fb.string("UTC")
+                                : 0;
+
+            std::uint8_t type_id = 0;
+            fb.start_table();
+            switch (c.spec.type) {
+            case column_type::int32:
+                type_id = type_int;
+                fb.add(0, std::int32_t{32});
+                fb.add(1, std::uint8_t{1});
+                break;
+            case column_type::float64:
+                type_id = type_floating_point;
+                fb.add(0, precision_double);
+                break;
+            case column_type::boolean:
+                type_id = type_bool;
+                break;
+            case column_type::utf8:
+                type_id = type_utf8;
+                break;
+            case column_type::timestamp:
+                type_id = type_timestamp;
+                fb.add(0, unit_nanosecond);
+                fb.add_offset(1, tz);
+                break;
+            case column_type::duration:
+                type_id = type_duration;
+                fb.add(0, unit_nanosecond);
+                break;
+            }
+            const auto type = fb.end_table();
+
+            fb.start_table();
+            fb.add_offset(0, name);
+            fb.add(1, std::uint8_t{1}); // nullable
+            fb.add(2, type_id);
+            fb.add_offset(3, type);
+            fb.add_offset(5, children);
+            fields.push_back(fb.end_table());
+        }
+        const auto fields_ref = fb.offsets(fields);
+        fb.start_table();
+        fb.add(0, std::int16_t{0}); // little endian
+        fb.add_offset(1, fields_ref);
+        return fb.end_table();
+    }
+
+    // Writes an encapsulated message and returns the length of its
+    // metadata including the continuation/length prefix and padding.
+    std::size_t write_message(fb_builder &fb, std::uint8_t header_type,
+                              fb_builder::ref header,
+                              std::span<const std::uint8_t> body) {
+        fb.start_table();
+        fb.add(3, static_cast<std::int64_t>(body.size()));
+        fb.add_offset(2, header);
+        fb.add(0, metadata_v5);
+        fb.add(1, header_type);
+        const auto meta = fb.finish(fb.end_table());
+
+        // keep the body 8-byte aligned
+        const auto padded = (meta.size() + 7) & ~std::size_t{7};
+        const std::uint32_t prefix[2] = {continuation,
+                                         static_cast<std::uint32_t>(padded)};
+        write_bytes(prefix, sizeof(prefix));
+        write_bytes(meta.data(), meta.size());
+        static constexpr std::uint8_t zeros[8] = {};
+        write_bytes(zeros, padded - meta.size());
+        write_bytes(body.data(), body.size());
+        return sizeof(prefix) + padded;
+    }
+
+    void write_bytes(const void *p, std::size_t n) {
+        const auto *b = static_cast<const char *>(p);
+        while (n > 0) {
+            const auto w = ::write(fd_, b, n);
+            if (w < 0 && errno == EINTR) {
+                continue;
+            }
+            verify(w > 0, "arrow writer: write: {}", std::strerror(errno));
+            b += w;
+            n -= static_cast<std::size_t>(w);
+            file_pos_ += static_cast<std::size_t>(w);
+        }
+    }
+
+    arrow_format format_;
+    std::size_t batch_rows_;
+    std::vector<column> columns_;
+    std::size_t rows_ = 0;
+    int fd_ = -1;
+    std::size_t file_pos_ = 0;
+    std::vector<block> blocks_; // record batches, for the file footer
+};
+} // namespace detail
+
+namespace {
+using detail::column_type;
+
+enum tick_column : std::size_t {
+    tc_quote_id,
+    tc_bid,
+    tc_ask,
+    tc_daily_change,
+    tc_dir,
+    tc_tradable,
+    tc_high,
+    tc_low,
+    tc_hash,
+    tc_call_only,
+    tc_mid_price,
+    tc_timestamp,
+    tc_field13,
+    tc_group,
+    tc_latency,
+    tc_network_latency,
+    tc_received,
+    tc_decoded
+};
+
+enum candle_column : std::size_t {
+    cc_timestamp,
+    cc_open,
+    cc_high,
+    cc_low,
+    cc_close,
+    cc_volume
+};
+} // namespace
+
+arrow_tick_writer::arrow_tick_writer(const std::string &path,
+                                     arrow_format format,
+                                     std::size_t batch_rows)
+    : ipc_(std::make_unique<detail::arrow_ipc>(
+          path, format, batch_rows,
+          std::initializer_list<detail::column_spec>{
+              {"quote_id", column_type::int32},
+              {"bid", column_type::float64},
+              {"ask", column_type::float64},
+              {"daily_change", column_type::float64},
+              {"dir", column_type::utf8},
+              {"tradable", column_type::boolean},
+              {"high", column_type::float64},
+              {"low", column_type::float64},
+              {"hash", column_type::utf8},
+              {"call_only", column_type::boolean},
+              {"mid_price", column_type::float64},
+              {"timestamp", column_type::timestamp},
+              {"field13", column_type::int32},
+              {"group", column_type::utf8},
+              {"latency", column_type::duration},
+              {"network_latency", column_type::duration},
+              {"received", column_type::timestamp},
+              {"decoded", column_type::timestamp}})) {}
+
+arrow_tick_writer::~arrow_tick_writer() = default;
+
+void arrow_tick_writer::write(const tick &t) {
+    auto &w = *ipc_;
+    w.put(tc_quote_id, std::int32_t{t.quote_id});
+    w.put(tc_bid, t.bid);
+    w.put(tc_ask, t.ask);
+    w.put(tc_daily_change, t.daily_change);
+    w.put(tc_dir, to_string(t.dir));
+    w.put(tc_tradable, t.tradable);
+    w.put(tc_high, t.high);
+    w.put(tc_low, t.low);
+    w.put(tc_hash, std::string_view(t.hash));
+    w.put(tc_call_only, t.call_only);
+    w.put(tc_mid_price, t.mid_price);
+    w.put(tc_timestamp, to_ns(t.timestamp));
+    w.put(tc_field13, std::int32_t{t.field13});
+    w.put(tc_group, to_string(t.group));
+    w.put(tc_latency, static_cast<std::int64_t>(t.latency.count()));
+    w.put(tc_network_latency,
+          static_cast<std::int64_t>(t.network_latency().count()));
+    w.put(tc_received, to_ns(t.received));
+    w.put(tc_decoded, to_ns(t.decoded));
+    w.end_row();
+}
+
+void arrow_tick_writer::write(const stored_tick &t) {
+    auto &w = *ipc_;
+    w.put(tc_quote_id, std::int32_t{t.quote_id});
+    w.put(tc_bid, t.bid);
+    w.put(tc_ask, t.ask);
+    w.put(tc_daily_change, t.daily_change);
+    w.put(tc_dir, to_string(t.dir));
+    w.put(tc_tradable, t.tradable);
+    w.put(tc_high, t.high);
+    w.put(tc_low, t.low);
+    w.put(tc_hash, t.hash);
+    w.put(tc_call_only, t.call_only);
+    w.put(tc_mid_price, t.mid_price);
+    w.put(tc_timestamp, to_ns(t.timestamp));
+    w.put(tc_field13, std::int32_t{t.field13});
+    w.put(tc_group, to_string(t.group));
+    w.put_null(tc_latency, sizeof(std::int64_t)); // not stored
+    w.put(tc_network_latency, to_ns(t.received) - to_ns(t.timestamp));
+    w.put(tc_received, to_ns(t.received));
+    w.put_null(tc_decoded, sizeof(std::int64_t)); // not stored
+    w.end_row();
+}
+
+void arrow_tick_writer::flush() { ipc_->flush(); }
+
+void arrow_tick_writer::close() { ipc_->close(); }
+
+arrow_candle_writer::arrow_candle_writer(const std::string &path,
+                                         arrow_format format,
+                                         std::size_t batch_rows)
+    : ipc_(std::make_unique<detail::arrow_ipc>(
+          path, format, batch_rows,
+          std::initializer_list<detail::column_spec>{
+              {"timestamp", column_type::timestamp},
+              {"open", column_type::float64},
+              {"high", column_type::float64},
+              {"low", column_type::float64},
+              {"close", column_type::float64},
+              {"volume", column_type::float64}})) {}
+
+arrow_candle_writer::~arrow_candle_writer() = default;
+
+void arrow_candle_writer::write(const candle &c) {
+    auto &w = *ipc_;
+    w.put(cc_timestamp,
+          static_cast<std::int64_t>(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  c.timestamp.time_since_epoch())
+                  .count()));
+    w.put(cc_open, c.open);
+    w.put(cc_high, c.high);
+    w.put(cc_low, c.low);
+    w.put(cc_close, c.close);
+    w.put(cc_volume, c.volume);
+    w.end_row();
+}
+
+void arrow_candle_writer::write(std::span<const candle> candles) {
+    for (const auto &c : candles) {
+        write(c);
+    }
+}
+
+void arrow_candle_writer::flush() { ipc_->flush(); }
+
+void arrow_candle_writer::close() { ipc_->close(); }
+
+} // namespace td365
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/candle_cache.h>
+
+#include <td365/verify.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+namespace td365 {
+namespace {
+static_assert(std::is_trivially_copyable_v<candle>);
+
+constexpr char cache_magic[8] = {'T', 'D', '3', '6', '5', 'C', 'D', 'L'};
+constexpr std::uint32_t cache_version = 1;
+
+// Candles are stored as the in-memory struct so the mapping can be used
+// as-is; the header pins down everything that layout depends on.
+struct cache_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t record_size;
+    std::int64_t clock_den; // system_clock ticks per second
+    std::uint32_t duration;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(cache_header) == 32);
+
+cache_header expected_header(chart_duration dur) {
+    cache_header h{};
+    std::memcpy(h.magic, cache_magic, sizeof(cache_magic));
+    h.version = cache_version;
+    h.record_size = sizeof(candle);
+    h.clock_den = std::chrono::system_clock::period::den;
+    h.duration = static_cast<std::uint32_t>(to_duration(dur).count());
+    return h;
+}
+
+std::string_view to_string(chart_duration dur) {
+    switch (dur) {
+    case chart_duration::m1:
+        return "m1";
+    default:
+        return "unknown";
+    }
+}
+
+bool earlier(const candle &a, const candle &b) {
+    return a.timestamp < b.timestamp;
+}
+} // namespace
+
+candle_cache::candle_cache(std::string directory)
+    : directory_(std::move(directory)) {
+    std::filesystem::create_directories(directory_);
+}
+
+candle_cache::~candle_cache() {
+    for (auto &[key, e] : entries_) {
+        if (e.map != nullptr) {
+            ::munmap(const_cast<char *>(e.map), e.map_len);
+        }
+        if (e.fd >= 0) {
+            ::close(e.fd);
+        }
+    }
+}
+
+candle_cache::entry &candle_cache::open(int market_id, chart_duration dur) {
+    auto [it, inserted] = entries_.try_emplace({market_id, dur});
+    auto &e = it->second;
+    if (!inserted) {
+        return e;
+    }
+
+    const auto base = std::format("{}/{}-{}", directory_, market_id,
+                                  to_string(dur));
+    const auto path = base + ".candles";
+    e.ranges_path = base + ".ranges";
+
+    e.fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (e.fd < 0) {
+        entries_.erase(it);
+        throw fail("candle_cache: open {}: {}", path, std::strerror(errno));
+    }
+
+    struct stat st {};
+    if (::fstat(e.fd, &st) != 0) {
+        ::close(e.fd);
+        entries_.erase(it);
+        throw fail("candle_cache: fstat {}: {}", path, std::strerror(errno));
+    }
+    const auto size = static_cast<std::size_t>(st.st_size);
+    const auto want = expected_header(dur);
+
+    cache_header have{};
+    const bool valid =
+        size >= sizeof(have) &&
+        ::pread(e.fd, &have, sizeof(have), 0) ==
+            static_cast<ssize_t>(sizeof(have)) &&
+        std::memcmp(&have, &want, sizeof(want)) == 0;
+
+    if (!valid) {
+        if (size > 0) {
+            spdlog::warn("candle_cache: {}: incompatible, starting over", path);
+        }
+        if (::ftruncate(e.fd, 0) != 0 ||
+            ::pwrite(e.fd, &want, sizeof(want), 0) !=
+                static_cast<ssize_t>(sizeof(want))) {
+            throw fail("candle_cache: {}: {}", path, std::strerror(errno));
+        }
+        std::filesystem::remove(e.ranges_path);
+    } else {
+        e.count = (size - sizeof(cache_header)) / sizeof(candle);
+        if (sizeof(cache_header) + e.count * sizeof(candle) != size) {
+            // torn by a crash mid-merge; whatever the ranges claimed about
+            // the tail can no longer be trusted
+            spdlog::warn("candle_cache: {}: torn, dropping ranges", path);
+            std::filesystem::remove(e.ranges_path);
+        }
+
+        std::ifstream f(e.ranges_path, std::ios::binary);
+        std::int64_t r[2];
+        while (f.read(reinterpret_cast<char *>(r), sizeof(r))) {
+            e.ranges.push_back(
+                {time_point(time_point::duration(r[0])),
+                 time_point(time_point::duration(r[1]))});
+        }
+    }
+
+    remap(e);
+    return e;
+}
+
+void candle_cache::remap(entry &e) {
+    if (e.map != nullptr) {
+        ::munmap(const_cast<char *>(e.map), e.map_len);
+        e.map = nullptr;
+        e.base = nullptr;
+    }
+    if (e.count == 0) {
+        return;
+    }
+
+    e.map_len = sizeof(cache_header) + e.count * sizeof(candle);
+    void *p = ::mmap(nullptr, e.map_len, PROT_READ, MAP_SHARED, e.fd, 0);
+    if (p == MAP_FAILED) {
+        throw fail("candle_cache: mmap: {}", std::strerror(errno));
+    }
+    e.map = static_cast<const char *>(p);
+    e.base = reinterpret_cast<const candle *>(e.map + sizeof(cache_header));
+}
+
+void candle_cache::save_ranges(const entry &e) {
+    std::ofstream f(e.ranges_path, std::ios::binary | std::ios::trunc);
+    for (const auto &r : e.ranges) {
+        const std::int64_t v[2] = {r.from.time_since_epoch().count(),
+                                   r.to.time_since_epoch().count()};
+        f.write(reinterpret_cast<const char *>(v), sizeof(v));
+    }
+    verify(f.good(), "candle_cache: write {}", e.ranges_path);
+}
+
+std::span<const candle> candle_cache::candles(int market_id,
+                                              chart_duration dur) {
+    auto &e = open(market_id, dur);
+    return {e.base, e.count};
+}
+
+std::span<const candle_cache::range>
+candle_cache::ranges(int market_id, chart_duration dur) {
+    return open(market_id, dur).ranges;
+}
+
+void candle_cache::merge(int market_id, chart_duration dur,
+                         std::span<const candle> fetched,
+                         time_point fetched_at) {
+    if (fetched.empty()) {
+        return;
+    }
+    auto &e = open(market_id, dur);
+
+    std::vector<candle> fresh(fetched.begin(), fetched.end());
+    std::ranges::stable_sort(fresh, earlier);
+
+    // Usually only the tail overlaps: rewrite from the first cached candle
+    // the fetch covers, keeping any cached ones it does not.
+    const std::span<const candle> held{e.base, e.count};
+    const auto from = static_cast<std::size_t>(
+        std::ranges::lower_bound(held, fresh.front(), earlier) - held.begin());
+
+    std::vector<candle> tail;
+    tail.reserve(fresh.size() + held.size() - from);
+    auto h = held.begin() + static_cast<std::ptrdiff_t>(from);
+    for (auto f = fresh.begin(); f != fresh.end(); ++f) {
+        for (; h != held.end() && h->timestamp < f->timestamp; ++h) {
+            tail.push_back(*h);
+        }
+        if (h != held.end() && h->timestamp == f->timestamp) {
+            ++h; // replaced by the fresher copy
+        }
+        if (!tail.empty() && tail.back().timestamp == f->timestamp) {
+            tail.back() = *f; // duplicate within the fetch, keep the last
+        } else {
+            tail.push_back(*f);
+        }
+    }
+    tail.insert(tail.end(), h, held.end());
+
+    const auto offset = sizeof(cache_header) + from * sizeof(candle);
+    const auto bytes = tail.size() * sizeof(candle);
+    if (::pwrite(e.fd, tail.data(), bytes, static_cast<off_t>(offset)) !=
+            static_cast<ssize_t>(bytes) ||
+        ::ftruncate(e.fd, static_cast<off_t>(offset + bytes)) != 0) {
+        throw fail("candle_cache: write market {}: {}", market_id,
+                   std::strerror(errno));
+    }
+    e.count = from + tail.size();
+    remap(e);
+
+    // coalesce the newly covered range with any it overlaps or touches
+    e.ranges.push_back({fresh.front().timestamp, fetched_at});
+    std::ranges::sort(e.ranges, {}, &range::from);
+    std::vector<range> merged;
+    for (const auto &r : e.ranges) {
+        if (!merged.empty() &&
+            r.from <= merged.back().to + to_duration(dur)) {
+            merged.back().to = std::max(merged.back().to, r.to);
+        } else {
+            merged.push_back(r);
+        }
+    }
+    e.ranges = std::move(merged);
+    save_ranges(e);
+}
+
+} // namespace td365
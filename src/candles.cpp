@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/candles.h>
+
+#include <td365/verify.h>
+
+#include <algorithm>
+#include <ranges>
+
+namespace td365 {
+namespace {
+std::int64_t bucket_of(std::chrono::system_clock::time_point t, size_t tf) {
+    auto secs =
+        std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch())
+            .count();
+    auto width = to_duration(static_cast<timeframe>(tf)).count();
+    // floor, so pre-epoch times don't round towards zero
+    return secs >= 0 ? secs / width : (secs - width + 1) / width;
+}
+
+std::chrono::system_clock::time_point bucket_start(std::int64_t bucket,
+                                                   size_t tf) {
+    return std::chrono::system_clock::time_point(
+        bucket * to_duration(static_cast<timeframe>(tf)));
+}
+} // namespace
+
+candle_aggregator::candle_aggregator(std::size_t history) : history_(history) {
+    verify(history_ > 0, "candle_aggregator: history must be positive");
+}
+
+candle_aggregator::quote_state &candle_aggregator::slot(int quote_id) {
+    auto [it, inserted] = quotes_.try_emplace(quote_id);
+    if (inserted) {
+        it->second.rings = std::make_unique<candle[]>(timeframes * history_);
+    }
+    return it->second;
+}
+
+void candle_aggregator::track(int quote_id) { slot(quote_id); }
+
+void candle_aggregator::apply(int quote_id, quote_state &q, size_t tf,
+                              std::int64_t bucket, const candle &c,
+                              bool notify) {
+    auto &s = q.series[tf];
+    if (s.open && bucket == s.bucket) {
+        s.current.high = std::max(s.current.high, c.high);
+        s.current.low = std::min(s.current.low, c.low);
+        s.current.close = c.close;
+        s.current.volume += c.volume;
+        return;
+    }
+    if (s.open && bucket < s.bucket) {
+        return; // late, its candle is already closed
+    }
+
+    if (s.open) {
+        q.rings[tf * history_ + s.head] = s.current;
+        s.head = (s.head + 1) % history_;
+        s.count = std::min(s.count + 1, history_);
+        if (notify && on_close_) {
+            on_close_(quote_id, static_cast<timeframe>(tf), s.current);
+        }
+    }
+
+    s.bucket = bucket;
+    s.open = true;
+    s.current = c;
+    s.current.timestamp = bucket_start(bucket, tf);
+}
+
+void candle_aggregator::on_tick(const tick &t) {
+    auto it = quotes_.find(t.quote_id);
+    auto &q = it != quotes_.end() ? it->second : slot(t.quote_id);
+
+    const auto ts =
+        std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+            t.timestamp);
+    const auto price = t.mid_price;
+    const candle c{.timestamp = ts,
+                   .open = price,
+                   .high = price,
+                   .low = price,
+                   .close = price,
+                   .volume = 1};
+    for (size_t tf = 0; tf < timeframes; ++tf) {
+        apply(t.quote_id, q, tf, bucket_of(ts, tf), c, true);
+    }
+}
+
+void candle_aggregator::seed(int quote_id, timeframe tf,
+                             std::span<const candle> candles) {
+    if (candles.empty()) {
+        return;
+    }
+    auto &q = slot(quote_id);
+    const auto width = to_duration(tf);
+
+    auto feed = [&](const candle &c) {
+        for (size_t t = 0; t < timeframes; ++t) {
+            if (to_duration(static_cast<timeframe>(t)) >= width) {
+                apply(quote_id, q, t, bucket_of(c.timestamp, t), c, false);
+            }
+        }
+    };
+
+    if (candles.front().timestamp <= candles.back().timestamp) {
+        std::ranges::for_each(candles, feed);
+    } else {
+        std::ranges::for_each(candles | std::views::reverse, feed);
+    }
+}
+
+candle_series candle_aggregator::series(int quote_id, timeframe tf) const {
+    static const candle empty{};
+    auto it = quotes_.find(quote_id);
+    if (it == quotes_.end()) {
+        return {&empty, 1, 0, 0, false, empty};
+    }
+    const auto i = static_cast<size_t>(tf);
+    const auto &s = it->second.series[i];
+    return {&it->second.rings[i * history_], history_, s.head, s.count, s.open,
+            s.current};
+}
+
+} // namespace td365
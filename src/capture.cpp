@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/capture.h>
+
+#include <td365/verify.h>
+#include <td365/ws_client.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <optional>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace td365 {
+namespace {
+constexpr char capture_magic[8] = {'T', 'D', '3', '6', '5', 'C', 'A', 'P'};
+constexpr std::uint32_t capture_version = 1;
+constexpr std::size_t file_header_size = 16;
+constexpr std::size_t record_header_size =
+    sizeof(std::int64_t) + sizeof(std::uint32_t);
+} // namespace
+
+capture_writer::capture_writer(const std::string &path, std::size_t window)
+    : window_(std::max(window, file_header_size)) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    verify(fd_ >= 0, "capture_writer: open {}: {}", path, std::strerror(errno));
+
+    try {
+        remap(file_header_size);
+    } catch (...) {
+        // the destructor won't run
+        ::close(fd_);
+        throw;
+    }
+    std::memcpy(base_, capture_magic, sizeof(capture_magic));
+    std::memcpy(base_ + sizeof(capture_magic), &capture_version,
+                sizeof(capture_version));
+    pos_ = file_header_size;
+}
+
+capture_writer::~capture_writer() {
+    if (base_ != nullptr) {
+        ::munmap(base_, map_len_);
+    }
+    if (fd_ >= 0) {
+        // drop the unused tail of the last window
+        if (::ftruncate(fd_, static_cast<off_t>(pos_)) != 0) {
+            spdlog::error("capture_writer: ftruncate: {}",
+                          std::strerror(errno));
+        }
+        ::close(fd_);
+    }
+}
+
+void capture_writer::remap(std::size_t needed) {
+    if (base_ != nullptr) {
+        ::munmap(base_, map_len_);
+        base_ = nullptr;
+    }
+
+    // mmap offsets must be page aligned; keep the partially written page
+    static const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    map_off_ = pos_ - (pos_ % page);
+    map_len_ = std::max(window_, pos_ - map_off_ + needed);
+
+    // allocate the blocks now: on a sparse file a full disk would only show
+    // up as a SIGBUS when a page of the window is first written
+    if (const auto rc =
+            ::posix_fallocate(fd_, static_cast<off_t>(map_off_),
+                              static_cast<off_t>(map_len_));
+        rc != 0) {
+        throw fail("capture_writer: fallocate: {}", std::strerror(rc));
+    }
+
+    // no MAP_POPULATE: faulting in a whole window here would stall the feed
+    void *p = ::mmap(nullptr, map_len_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd_, static_cast<off_t>(map_off_));
+    if (p == MAP_FAILED) {
+        throw fail("capture_writer: mmap: {}", std::strerror(errno));
+    }
+    base_ = static_cast<char *>(p);
+}
+
+void capture_writer::append(capture_frame::time_type received,
+                            std::string_view payload) {
+    if (failed_) {
+        return;
+    }
+    const std::size_t needed = record_header_size + payload.size();
+    if (pos_ + needed > map_off_ + map_len_) [[unlikely]] {
+        // runs on the feed thread: losing the capture beats losing the feed
+        try {
+            remap(needed);
+        } catch (const std::exception &) {
+            spdlog::error("capture_writer: stopped after {} frames", frames_);
+            failed_ = true;
+            return;
+        }
+    }
+
+    const std::int64_t ts = received.time_since_epoch().count();
+    const auto len = static_cast<std::uint32_t>(payload.size());
+
+    char *dst = base_ + (pos_ - map_off_);
+    std::memcpy(dst, &ts, sizeof(ts));
+    std::memcpy(dst + sizeof(ts), &len, sizeof(len));
+    std::memcpy(dst + record_header_size, payload.data(), payload.size());
+
+    pos_ += needed;
+    ++frames_;
+}
+
+capture_reader::capture_reader(const std::string &path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    verify(fd_ >= 0, "capture_reader: open {}: {}", path, std::strerror(errno));
+
+    struct stat st {};
+    if (::fstat(fd_, &st) != 0) {
+        ::close(fd_);
+        throw fail("capture_reader: fstat {}: {}", path, std::strerror(errno));
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+
+    if (size_ < file_header_size) {
+        ::close(fd_);
+        throw fail("capture_reader: {} is not a capture file", path);
+    }
+
+    void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (p == MAP_FAILED) {
+        ::close(fd_);
+        throw fail("capture_reader: mmap {}: {}", path, std::strerror(errno));
+    }
+    base_ = static_cast<const char *>(p);
+    ::madvise(const_cast<char *>(base_), size_, MADV_SEQUENTIAL);
+
+    std::uint32_t version = 0;
+    std::memcpy(&version, base_ + sizeof(capture_magic), sizeof(version));
+    if (std::memcmp(base_, capture_magic, sizeof(capture_magic)) != 0 ||
+        version != capture_version) {
+        ::munmap(const_cast<char *>(base_), size_);
+        ::close(fd_);
+        throw fail("capture_reader: {}: bad header", path);
+    }
+
+    pos_ = file_header_size;
+}
+
+capture_reader::~capture_reader() {
+    if (base_ != nullptr) {
+        ::munmap(const_cast<char *>(base_), size_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool capture_reader::next(capture_frame &frame) {
+    if (pos_ + record_header_size > size_) {
+        return false;
+    }
+
+    std::int64_t ts = 0;
+    std::uint32_t len = 0;
+    std::memcpy(&ts, base_ + pos_, sizeof(ts));
+    std::memcpy(&len, base_ + pos_ + sizeof(ts), sizeof(len));
+
+    // zeroed tail of a capture that was not closed, or a torn last record
+    if ((ts == 0 && len == 0) || pos_ + record_header_size + len > size_) {
+        return false;
+    }
+
+    frame.received = capture_frame::time_type{std::chrono::nanoseconds{ts}};
+    frame.payload = std::string_view{base_ + pos_ + record_header_size, len};
+    pos_ += record_header_size + len;
+    return true;
+}
+
+void capture_reader::rewind() { pos_ = file_header_size; }
+
+replay_stats replay(capture_reader &reader, ws_client &client,
+                    replay_speed speed) {
+    replay_stats stats;
+    capture_frame frame{};
+    std::optional<capture_frame::time_type> first;
+
+    const auto start = std::chrono::steady_clock::now();
+    while (reader.next(frame)) {
+        if (speed == replay_speed::recorded) {
+            if (!first) {
+                first = frame.received;
+            }
+            std::this_thread::sleep_until(start + (frame.received - *first));
+        }
+        client.replay(frame.payload, frame.received);
+        ++stats.frames;
+    }
+    stats.elapsed = std::chrono::steady_clock::now() - start;
+    return stats;
+}
+
+} // namespace td365
@@ -73,7 +73,7 @@ void cookiejar::save() const {
     }
 }
 
-void cookiejar::update(const http_response &res) {
+void cookiejar::update(const http_response_header &res) {
     for (const auto &h : res) {
         if (h.name() == boost::beast::http::field::set_cookie) {
             std::string header_value = h.value();
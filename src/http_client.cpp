@@ -8,23 +8,27 @@
 #include <td365/http_client.h>
 
 #include <td365/constants.h>
+#include <td365/inflate.h>
+#include <td365/net_profile.h>
+#include <td365/resolver.h>
+#include <td365/tls.h>
 #include <td365/utils.h>
 #include <td365/verify.h>
 
 #include <boost/asio/awaitable.hpp>
 #include <boost/asio/co_spawn.hpp>
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/redirect_error.hpp>
 #include <boost/asio/ssl.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
-#include <boost/beast/http/dynamic_body.hpp>
+#include <boost/beast/http/string_body.hpp>
 #include <boost/beast/ssl/ssl_stream.hpp>
 #include <boost/beast/version.hpp>
-#include <boost/iostreams/copy.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/filtering_streambuf.hpp>
 #include <boost/url/url.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <sys/socket.h>
 
 namespace td365 {
     namespace net = boost::asio;
@@ -35,6 +39,20 @@ namespace td365 {
     namespace ssl = boost::asio::ssl;
 
     constexpr auto const kBodySizeLimit = 128U * 1024U * 1024U; // 128 M
+    constexpr auto const kStreamWindow = 64U * 1024U;
+    constexpr auto const kFirstRead = 16U * 1024U;
+
+    // A reused connection the server closed between the health check and
+    // the request fails like this. Only GETs are resent: a POST may have
+    // reached the server before the connection went.
+    bool retryable(http::verb verb, const auto &conn,
+                   const boost::system::error_code &ec) {
+        return verb == http::verb::get && conn.reused() &&
+               (ec == http::error::end_of_stream || ec == net::error::eof ||
+                ec == net::error::connection_reset ||
+                ec == net::error::broken_pipe ||
+                ec == ssl::error::stream_truncated);
+    }
 
     auto create_default_headers() {
         http_headers hdrs;
@@ -51,42 +69,164 @@ namespace td365 {
         {to_string(http::field::content_type), "application/json; charset=utf-8"}
     };
 
-    http_client::http_client(boost::asio::any_io_executor ex, std::string host)
-        : stream_(ex, ssl_ctx()), host_(std::move(host)), jar_(host_ + ".cookies"),
-          default_headers_(create_default_headers()) {
+    http_client::http_client(boost::asio::any_io_executor ex, std::string host,
+                             http_client_options opts)
+        : host_(std::move(host)), jar_(std::make_shared<cookiejar>(host_ + ".cookies")),
+          default_headers_(create_default_headers()), opts_(opts),
+          connection_freed_(ex, net::steady_timer::time_point::max()) {
         default_headers_.emplace(to_string(http::field::host), host_);
     }
 
-    awaitable<void> http_client::ensure_connected() {
-        if (!stream_.lowest_layer().is_open()) {
-            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
-            if (!SSL_set_tlsext_host_name(stream_.native_handle(),
-                                          const_cast<char *>(host_.c_str()))) {
-                throw boost::system::system_error{
-                    {
-                        static_cast<int>(::ERR_get_error()),
-                        boost::asio::error::get_ssl_category()
-                    }
-                };
+    http_client::connection::connection(boost::asio::any_io_executor ex)
+        : stream(ex, ssl_ctx()) {
+    }
+
+    http_client::lease::lease(http_client &owner, connection &conn)
+        : owner_(&owner), conn_(&conn) {
+    }
+
+    http_client::lease::lease(lease &&other) noexcept
+        : owner_(std::exchange(other.owner_, nullptr)), conn_(other.conn_),
+          reusable_(other.reusable_) {
+    }
+
+    http_client::lease::~lease() {
+        if (owner_ != nullptr) {
+            owner_->release(*conn_, reusable_);
+        }
+    }
+
+    bool http_client::healthy(connection &conn,
+                              std::chrono::steady_clock::time_point now) const {
+        auto &sock = beast::get_lowest_layer(conn.stream);
+        if (!sock.is_open() || now - conn.last_used > opts_.max_idle) {
+            return false;
+        }
+        // nothing should arrive on an idle connection: readable means the
+        // server closed it or sent a TLS alert
+        char byte;
+        const auto n = ::recv(sock.native_handle(), &byte, 1,
+                              MSG_PEEK | MSG_DONTWAIT);
+        return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+
+    http_client::connection *http_client::idle_connection() {
+        const auto now = std::chrono::steady_clock::now();
+        std::erase_if(pool_, [&](const auto &c) {
+            return !c->busy && !healthy(*c, now);
+        });
+        // max_connections may have been lowered since they were opened
+        while (pool_.size() > opts_.max_connections) {
+            auto oldest = std::ranges::min_element(pool_, [](const auto &a,
+                                                             const auto &b) {
+                return !a->busy && (b->busy || a->last_used < b->last_used);
+            });
+            if ((*oldest)->busy) {
+                break;
             }
+            pool_.erase(oldest);
+        }
 
-            auto const ep = co_await td_resolve(host_, "443");
-            co_await beast::get_lowest_layer(stream_).async_connect(*ep.begin(), boost::asio::use_awaitable);
+        // the most recently used, leaving the others to age out when load
+        // drops
+        connection *idle = nullptr;
+        for (auto &c: pool_) {
+            if (!c->busy && (idle == nullptr || c->last_used > idle->last_used)) {
+                idle = c.get();
+            }
+        }
+        return idle;
+    }
+
+    awaitable<http_client::lease> http_client::acquire() {
+        for (;;) {
+            if (auto *idle = idle_connection(); idle != nullptr) {
+                idle->busy = true;
+                ++idle->requests;
+                co_return lease{*this, *idle};
+            }
 
-            co_await stream_.async_handshake(ssl::stream_base::client, boost::asio::use_awaitable);
+            if (pool_.size() < opts_.max_connections) {
+                auto &c = *pool_.emplace_back(
+                    std::make_unique<connection>(connection_freed_.get_executor()));
+                c.busy = true;
+                ++c.requests;
+                auto l = lease{*this, c};
+                co_await connect(c);
+                co_return l;
+            }
+
+            boost::system::error_code ec;
+            co_await connection_freed_.async_wait(
+                net::redirect_error(net::use_awaitable, ec));
         }
+    }
 
-        co_return;
+    void http_client::share_session(const http_client &other) {
+        jar_ = other.jar_;
+        default_headers_ = other.default_headers_;
     }
 
-    boost::asio::awaitable<http_response>
-    http_client::send(boost::beast::http::verb verb, std::string_view target,
-                      std::optional<std::string> body,
-                      std::optional<http_headers> headers) {
-        co_await ensure_connected();
-        auto ex = co_await boost::asio::this_coro::executor;
+    awaitable<void> http_client::warm(std::string_view target,
+                                      std::chrono::seconds refresh) {
+        auto *idle = idle_connection();
+        if (idle == nullptr) {
+            if (pool_.size() >= opts_.max_connections) {
+                co_return;
+            }
+            auto &c = *pool_.emplace_back(
+                std::make_unique<connection>(connection_freed_.get_executor()));
+            c.busy = true;
+            // count the handshake as a use, so the first real request on it
+            // is retried like any other on a reused connection
+            c.requests = 1;
+            auto l = lease{*this, c};
+            co_await connect(c);
+            l.keep(true);
+            co_return;
+        }
+        if (std::chrono::steady_clock::now() - idle->last_used >= refresh) {
+            // acquire hands out this same connection
+            co_await post(target);
+        }
+    }
+
+    void http_client::release(connection &conn, bool reusable) {
+        if (reusable) {
+            conn.busy = false;
+            conn.last_used = std::chrono::steady_clock::now();
+        } else {
+            std::erase_if(pool_, [&](const auto &c) { return c.get() == &conn; });
+        }
+        connection_freed_.cancel_one();
+    }
+
+    awaitable<void> http_client::connect(connection &conn) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+        if (!SSL_set_tlsext_host_name(conn.stream.native_handle(),
+                                      const_cast<char *>(host_.c_str()))) {
+            throw boost::system::system_error{
+                {
+                    static_cast<int>(::ERR_get_error()),
+                    boost::asio::error::get_ssl_category()
+                }
+            };
+        }
+        offer_tls_session(conn.stream.native_handle(), host_);
 
-        auto req = http::request<http::string_body>{verb, target, 11};
+        beast::get_lowest_layer(conn.stream) = co_await td_connect(host_, std::to_string(opts_.port));
+        apply_socket_options(beast::get_lowest_layer(conn.stream),
+                             opts_.sockets);
+
+        co_await conn.stream.async_handshake(ssl::stream_base::client, boost::asio::use_awaitable);
+        record_tls_handshake(conn.stream.native_handle());
+    }
+
+    http_request http_client::make_request(http::verb verb,
+                                           std::string_view target,
+                                           std::optional<std::string> body,
+                                           std::optional<http_headers> headers) {
+        auto req = http_request{verb, target, 11};
 
         if (!default_headers_.empty()) {
             for (const auto &[name, value]: default_headers_) {
@@ -100,43 +240,160 @@ namespace td365 {
             }
         }
 
-        jar_.apply(req);
+        jar_->apply(req);
 
         if (body.has_value()) {
-            req.body() = *body;
+            req.body() = std::move(*body);
             req.prepare_payload();
         } else if (verb == http::verb::post) {
             req.set(http::field::content_length, "0");
         }
+        return req;
+    }
 
-        try {
-            co_await http::async_write(stream_, req, boost::asio::use_awaitable);
+    boost::asio::awaitable<http_response>
+    http_client::send(boost::beast::http::verb verb, std::string_view target,
+                      std::optional<std::string> body,
+                      std::optional<http_headers> headers,
+                      request_timing *timing,
+                      const body_handler *on_decoded) {
+        auto req = make_request(verb, target, std::move(body), std::move(headers));
+
+        for (int attempt = 0;; ++attempt) {
+            auto conn = co_await acquire();
+            try {
+                co_await http::async_write(conn.stream(), req, boost::asio::use_awaitable);
+                if (timing != nullptr) {
+                    timing->written = std::chrono::steady_clock::now();
+                }
 
-            auto p = http::response_parser<http::dynamic_body>{};
-            p.eager(true);
-            p.body_limit(kBodySizeLimit);
+                // the string body is sized from Content-Length up front
+                auto p = http::response_parser<http::string_body>{};
+                p.eager(true);
+                p.body_limit(kBodySizeLimit);
 
-            auto buffer = beast::flat_buffer{};
-            co_await http::async_read(stream_, buffer, p,
-                                      boost::asio::use_awaitable);
+                if (timing != nullptr) {
+                    // the first bytes straight off the socket, to see when
+                    // the response began; the parser takes them from the
+                    // buffer
+                    if (conn.buffer().size() == 0) {
+                        boost::system::error_code ec;
+                        const auto n = co_await conn.stream().async_read_some(
+                            conn.buffer().prepare(kFirstRead),
+                            net::redirect_error(net::use_awaitable, ec));
+                        if (ec == net::error::eof) {
+                            ec = http::error::end_of_stream; // as beast has it
+                        }
+                        if (ec) {
+                            throw boost::system::system_error(ec);
+                        }
+                        conn.buffer().commit(n);
+                    }
+                    timing->first_byte = std::chrono::steady_clock::now();
+                }
+                co_await http::async_read(conn.stream(), conn.buffer(), p,
+                                          boost::asio::use_awaitable);
 
-            auto response = p.release();
+                auto response = p.release();
 
-            jar_.update(response);
+                jar_->update(response);
+                conn.keep(response.keep_alive());
 
-            co_return response;
-        } catch (const boost::beast::error_code &ec) {
-            if (ec == http::error::end_of_stream) {
-                stream_.lowest_layer().close();
-                stream_ = stream_t(ex, ssl_ctx());
-            } else {
-                spdlog::error("http_client::send: {}", ec.message());
+                if (on_decoded != nullptr &&
+                    http::to_status_class(response.result()) ==
+                        http::status_class::successful) {
+                    (*on_decoded)(get_http_body(response, conn.decoded()));
+                }
+                co_return response;
+            } catch (const boost::system::system_error &e) {
+                // the connection is dropped with the lease
+                if (attempt == 0 && retryable(verb, conn, e.code())) {
+                    spdlog::debug("http_client::send: retrying {}: {}", target,
+                                  e.code().message());
+                    continue;
+                }
+                if (e.code() != http::error::end_of_stream) {
+                    spdlog::error("http_client::send: {}", e.code().message());
+                }
+                throw;
             }
-            throw ec;
         }
+    }
+
+    boost::asio::awaitable<http_response_header>
+    http_client::send_streamed(http::verb verb, std::string_view target,
+                               std::optional<std::string> body,
+                               std::optional<http_headers> headers,
+                               body_handler on_body) {
+        auto req = make_request(verb, target, std::move(body), std::move(headers));
+
+        for (int attempt = 0;; ++attempt) {
+            auto conn = co_await acquire();
+            bool delivered = false;
+            try {
+                co_await http::async_write(conn.stream(), req, boost::asio::use_awaitable);
+
+                auto p = http::response_parser<http::buffer_body>{};
+                p.body_limit(kBodySizeLimit);
+
+                co_await http::async_read_header(conn.stream(), conn.buffer(), p,
+                                                 boost::asio::use_awaitable);
+                jar_->update(p.get());
 
-        http_response resp{boost::beast::http::status::unknown, 11};
-        co_return resp;
+                const bool wanted = http::to_status_class(p.get().result()) ==
+                                    http::status_class::successful;
+                const bool gzipped =
+                        p.get()[http::field::content_encoding] == "gzip";
+                gzip_inflater inflater;
+
+                // the body is read a window at a time and passed straight on
+                auto &window = conn.window();
+                window.resize(kStreamWindow);
+                while (!p.is_done()) {
+                    p.get().body().data = window.data();
+                    p.get().body().size = window.size();
+
+                    boost::system::error_code ec;
+                    co_await http::async_read_some(
+                        conn.stream(), conn.buffer(), p,
+                        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+                    if (ec == http::error::need_buffer) {
+                        ec = {}; // the window is full
+                    }
+                    if (ec) {
+                        throw boost::system::system_error(ec);
+                    }
+
+                    const auto got = std::string_view(
+                        window.data(), window.size() - p.get().body().size);
+                    if (!wanted || got.empty()) {
+                        continue;
+                    }
+                    delivered = true;
+                    if (gzipped) {
+                        inflater.feed(got, on_body);
+                    } else {
+                        on_body(got);
+                    }
+                }
+
+                conn.keep(p.get().keep_alive());
+                co_return http_response_header(p.get().base());
+            } catch (const boost::system::system_error &e) {
+                // a handler that has seen part of a body cannot be replayed
+                if (attempt == 0 && !delivered &&
+                    retryable(verb, conn, e.code())) {
+                    spdlog::debug("http_client::send_streamed: retrying {}: {}",
+                                  target, e.code().message());
+                    continue;
+                }
+                if (e.code() != http::error::end_of_stream) {
+                    spdlog::error("http_client::send_streamed: {}",
+                                  e.code().message());
+                }
+                throw;
+            }
+        }
     }
 
     awaitable<http_response> http_client::get(std::string_view target,
@@ -146,7 +403,37 @@ namespace td365 {
 
     awaitable<http_response>
     http_client::post(std::string_view target, std::optional<std::string> body,
-                      std::optional<http_headers> headers) {
-        co_return co_await send(http::verb::post, target, body, headers);
+                      std::optional<http_headers> headers,
+                      request_timing *timing) {
+        co_return co_await send(http::verb::post, target, std::move(body),
+                                std::move(headers), timing);
+    }
+
+    awaitable<http_response_header>
+    http_client::post_decoded(std::string_view target,
+                              std::optional<std::string> body,
+                              body_handler on_body,
+                              std::optional<http_headers> headers,
+                              request_timing *timing) {
+        auto response = co_await send(http::verb::post, target, std::move(body),
+                                      std::move(headers), timing, &on_body);
+        co_return http_response_header(std::move(response.base()));
+    }
+
+    awaitable<http_response_header>
+    http_client::get_streamed(std::string_view target, body_handler on_body,
+                              std::optional<http_headers> headers) {
+        co_return co_await send_streamed(http::verb::get, target, std::nullopt,
+                                         std::move(headers), std::move(on_body));
+    }
+
+    awaitable<http_response_header>
+    http_client::post_streamed(std::string_view target,
+                               std::optional<std::string> body,
+                               body_handler on_body,
+                               std::optional<http_headers> headers) {
+        co_return co_await send_streamed(http::verb::post, target,
+                                         std::move(body), std::move(headers),
+                                         std::move(on_body));
     }
 } // namespace td365
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/inflate.h>
+
+#include <td365/verify.h>
+
+#include <algorithm>
+#include <zlib.h>
+
+namespace td365 {
+namespace {
+constexpr std::size_t window_size = 64 * 1024;
+constexpr int gzip_window_bits = 15 + 16; // max window, gzip wrapper only
+} // namespace
+
+gzip_inflater::gzip_inflater()
+    : zs_(std::make_unique<z_stream_s>()), window_(window_size) {
+    verify(::inflateInit2(zs_.get(), gzip_window_bits) == Z_OK,
+           "gzip_inflater: inflateInit2 failed");
+}
+
+gzip_inflater::~gzip_inflater() { ::inflateEnd(zs_.get()); }
+
+void gzip_inflater::reset() {
+    ::inflateReset(zs_.get());
+    done_ = false;
+}
+
+void gzip_inflater::feed(std::string_view in, const output_handler &out) {
+    // zlib's interface is not const-correct; it never writes through next_in
+    zs_->next_in =
+        reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+    zs_->avail_in = static_cast<uInt>(in.size());
+
+    while (!done_) {
+        zs_->next_out = reinterpret_cast<Bytef *>(window_.data());
+        zs_->avail_out = static_cast<uInt>(window_.size());
+
+        const auto rc = ::inflate(zs_.get(), Z_NO_FLUSH);
+        verify(rc == Z_OK || rc == Z_STREAM_END || rc == Z_BUF_ERROR,
+               "gzip_inflater: {}", zs_->msg != nullptr ? zs_->msg : "error");
+        done_ = rc == Z_STREAM_END;
+
+        const auto produced = window_.size() - zs_->avail_out;
+        if (produced > 0) {
+            out({window_.data(), produced});
+        }
+        // a full window may mean more output is pending even with the
+        // input used up
+        if (rc == Z_BUF_ERROR || (zs_->avail_in == 0 && zs_->avail_out > 0)) {
+            break;
+        }
+    }
+}
+
+void gzip_inflater::feed(std::string_view in, std::string &out,
+                         std::size_t &used) {
+    zs_->next_in =
+        reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+    zs_->avail_in = static_cast<uInt>(in.size());
+
+    while (!done_) {
+        if (used == out.size()) {
+            out.resize(std::max(out.size() * 2, window_size));
+        }
+        zs_->next_out = reinterpret_cast<Bytef *>(out.data() + used);
+        zs_->avail_out = static_cast<uInt>(out.size() - used);
+
+        const auto rc = ::inflate(zs_.get(), Z_NO_FLUSH);
+        verify(rc == Z_OK || rc == Z_STREAM_END || rc == Z_BUF_ERROR,
+               "gzip_inflater: {}", zs_->msg != nullptr ? zs_->msg : "error");
+        done_ = rc == Z_STREAM_END;
+        used = out.size() - zs_->avail_out;
+
+        if (rc == Z_BUF_ERROR || (zs_->avail_in == 0 && zs_->avail_out > 0)) {
+            break;
+        }
+    }
+}
+
+} // namespace td365
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/json_stream.h>
+
+namespace td365 {
+namespace {
+constexpr auto npos = std::string_view::npos;
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+std::string_view trim_right(std::string_view s) {
+    while (!s.empty() && is_space(s.back())) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+} // namespace
+
+json_array_stream::json_array_stream(std::string key,
+                                     element_handler on_element)
+    : key_(std::move(key)), on_element_(std::move(on_element)) {}
+
+void json_array_stream::feed(std::string_view chunk) {
+    if (done_) {
+        return;
+    }
+    // an element carried over from the last chunk continues at its start
+    start_ = partial_.empty() ? npos : 0;
+
+    for (std::size_t i = 0; i < chunk.size() && !done_; ++i) {
+        const char c = chunk[i];
+
+        if (in_string_) {
+            if (escape_) {
+                escape_ = false;
+            } else if (c == '\\') {
+                escape_ = true;
+            } else if (c == '"') {
+                in_string_ = false;
+                capture_key_ = false;
+                continue;
+            }
+            if (capture_key_) {
+                current_key_.push_back(c);
+            }
+            continue;
+        }
+
+        if (depth_ == array_depth_ && start_ == npos && !is_space(c) &&
+            c != ',' && c != ']') {
+            start_ = i;
+        }
+
+        switch (c) {
+        case '"':
+            in_string_ = true;
+            capture_key_ = expect_key_ && depth_ == 1;
+            if (capture_key_) {
+                current_key_.clear();
+            }
+            break;
+        case '[':
+            if (array_depth_ < 0 &&
+                ((key_.empty() && depth_ == 0) ||
+                 (!key_.empty() && depth_ == 1 && !expect_key_ &&
+                  current_key_ == key_))) {
+                array_depth_ = ++depth_;
+                break;
+            }
+            ++depth_;
+            break;
+        case '{':
+            ++depth_;
+            expect_key_ = depth_ == 1;
+            break;
+        case ']':
+        case '}':
+            if (depth_ == array_depth_) {
+                emit(chunk, i);
+                done_ = true;
+                break;
+            }
+            --depth_;
+            break;
+        case ',':
+            if (depth_ == array_depth_) {
+                emit(chunk, i);
+            } else if (depth_ == 1) {
+                expect_key_ = true;
+            }
+            break;
+        case ':':
+            if (depth_ == 1) {
+                expect_key_ = false;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (!done_ && start_ != npos) {
+        partial_.append(chunk.substr(start_));
+    }
+}
+
+void json_array_stream::emit(std::string_view chunk, std::size_t end) {
+    if (start_ == npos) {
+        return; // empty array
+    }
+    if (partial_.empty()) {
+        on_element_(trim_right(chunk.substr(start_, end - start_)));
+    } else {
+        partial_.append(chunk.substr(start_, end - start_));
+        on_element_(trim_right(partial_));
+        partial_.clear();
+    }
+    start_ = npos;
+}
+
+} // namespace td365
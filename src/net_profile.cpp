@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/net_profile.h>
+
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <spdlog/spdlog.h>
+#include <sys/socket.h>
+
+namespace td365 {
+namespace {
+using clock = std::chrono::steady_clock;
+
+// the recorder of the busy-poll loop running this thread
+thread_local wakeup_recorder *current_recorder = nullptr;
+} // namespace
+
+void apply_socket_options(boost::asio::ip::tcp::socket &socket,
+                          const socket_options &opts) {
+    boost::system::error_code ec;
+
+    if (opts.tcp_nodelay) {
+        socket.set_option(boost::asio::ip::tcp::no_delay(true), ec);
+        if (ec) {
+            spdlog::warn("TCP_NODELAY: {}", ec.message());
+        }
+    }
+
+    if (opts.receive_buffer > 0) {
+        socket.set_option(boost::asio::socket_base::receive_buffer_size(
+                              opts.receive_buffer),
+                          ec);
+        if (ec) {
+            spdlog::warn("SO_RCVBUF: {}", ec.message());
+        }
+    }
+
+#ifdef SO_BUSY_POLL
+    if (opts.busy_poll_us > 0) {
+        int value = opts.busy_poll_us;
+        if (::setsockopt(socket.native_handle(), SOL_SOCKET, SO_BUSY_POLL,
+                         &value, sizeof(value)) != 0) {
+            spdlog::warn("SO_BUSY_POLL: {}", std::strerror(errno));
+        }
+    }
+#endif
+}
+
+void pin_thread(int cpu) {
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<size_t>(cpu), &set);
+    if (auto rc = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+        rc != 0) {
+        spdlog::warn("pin_thread({}): {}", cpu, std::strerror(rc));
+    }
+}
+
+void wakeup_recorder::mark() {
+    current_recorder = this;
+    last_wakeup_ = clock::now();
+}
+
+void wakeup_recorder::record(std::int64_t ns) {
+    samples_.fetch_add(1, std::memory_order_relaxed);
+    total_ns_.fetch_add(ns, std::memory_order_relaxed);
+    auto min = min_ns_.load(std::memory_order_relaxed);
+    while (ns < min && !min_ns_.compare_exchange_weak(
+                           min, ns, std::memory_order_relaxed)) {
+    }
+    auto max = max_ns_.load(std::memory_order_relaxed);
+    while (ns > max && !max_ns_.compare_exchange_weak(
+                           max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+wakeup_stats wakeup_recorder::stats() const {
+    wakeup_stats s;
+    s.samples = samples_.load(std::memory_order_relaxed);
+    if (s.samples == 0) {
+        return s;
+    }
+    s.min = std::chrono::nanoseconds{min_ns_.load(std::memory_order_relaxed)};
+    s.max = std::chrono::nanoseconds{max_ns_.load(std::memory_order_relaxed)};
+    s.mean = std::chrono::nanoseconds{
+        total_ns_.load(std::memory_order_relaxed) /
+        static_cast<std::int64_t>(s.samples)};
+    return s;
+}
+
+void record_read() {
+    auto *r = current_recorder;
+    if (r == nullptr) {
+        return;
+    }
+    r->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  clock::now() - r->last_wakeup_)
+                  .count());
+}
+
+} // namespace td365
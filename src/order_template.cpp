@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/order_template.h>
+
+#include <td365/verify.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <format>
+
+namespace td365 {
+namespace {
+// the fields in nlohmann's (sorted) order, split where a value is patched in
+constexpr std::string_view before_key =
+    R"({"closePositionID":0,"hasClosingOrder":true,"isGuaranteed":false,)"
+    R"("isKaazingFeed":true,"key":")";
+constexpr std::string_view before_limit = R"(","limitOrderPrice":")";
+constexpr std::string_view before_stop = R"(","stopOrderPrice":")";
+constexpr std::string_view before_mode = R"(","tradeMode":)";
+constexpr std::string_view after_mode =
+    R"x(,"tradeType":1,"trailingPoint":0,"userAgent":"Firefox (139.0)"})x";
+
+// room for the key, four numbers and a bool
+constexpr std::size_t patched_reserve = 128 + 4 * 32 + 5;
+
+// what std::to_string gives, without the locale or the allocation
+void append_fixed6(std::string &out, double v) {
+    std::array<char, 64> buf;
+    auto [end, ec] = std::to_chars(buf.data(), buf.data() + buf.size(), v,
+                                   std::chars_format::fixed, 6);
+    verify(ec == std::errc{}, "order_template: cannot format {}", v);
+    out.append(buf.data(), end);
+}
+
+// nlohmann prints a finite double in shortest round-trip form, adding ".0"
+// to whole numbers, and switches to an exponent outside about 1e-5..1e15
+void append_price(std::string &out, double v) {
+    verify(std::isfinite(v) && (v == 0 || (std::fabs(v) >= 1e-4 &&
+                                           std::fabs(v) < 1e15)),
+           "order_template: unsupported price {}", v);
+    std::array<char, 64> buf;
+    auto [end, ec] = std::to_chars(buf.data(), buf.data() + buf.size(), v,
+                                   std::chars_format::fixed);
+    verify(ec == std::errc{}, "order_template: cannot format {}", v);
+    out.append(buf.data(), end);
+    if (std::find(buf.data(), end, '.') == end) {
+        out.append(".0");
+    }
+}
+
+bool is_base64(std::string_view s) {
+    return std::ranges::all_of(s, [](char c) {
+        return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+               (c >= '0' && c <= '9') || c == '+' || c == '/' || c == '=';
+    });
+}
+} // namespace
+
+order_template::order_template(int market_id, int quote_id)
+    : market_id_(market_id), quote_id_(quote_id),
+      after_limit_(std::format(
+          R"(","marketID":{},"orderModeID":3,"orderPriceModeID":2,)"
+          R"("orderTypeID":2,"price":)",
+          market_id)),
+      after_price_(std::format(R"(,"quoteID":{},"stake":")", quote_id)) {
+    buffer_.reserve(capacity());
+}
+
+std::size_t order_template::capacity() const {
+    return before_key.size() + before_limit.size() + after_limit_.size() +
+           after_price_.size() + before_stop.size() + before_mode.size() +
+           after_mode.size() + patched_reserve;
+}
+
+std::string_view order_template::render(const trade_request &request) {
+    render(request, buffer_);
+    return buffer_;
+}
+
+void order_template::render(const trade_request &request,
+                            std::string &out) const {
+    verify(request.market_id == market_id_ && request.quote_id == quote_id_,
+           "order_template: prepared for {}/{}, not {}/{}", market_id_,
+           quote_id_, request.market_id, request.quote_id);
+    verify(is_base64(request.key), "order_template: bad key '{}'",
+           request.key);
+
+    out.clear();
+    out.reserve(capacity());
+    out.append(before_key);
+    out.append(request.key);
+    out.append(before_limit);
+    append_fixed6(out, request.limit);
+    out.append(after_limit_);
+    append_price(out, request.price);
+    out.append(after_price_);
+    append_fixed6(out, request.stake);
+    out.append(before_stop);
+    append_fixed6(out, request.stop);
+    out.append(before_mode);
+    out.append(request.dir == trade_request::direction::sell ? "true"
+                                                             : "false");
+    out.append(after_mode);
+}
+
+} // namespace td365
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/order_trace.h>
+
+namespace td365 {
+
+void order_trace_log::push(const order_trace &trace) {
+    std::lock_guard lock(mutex_);
+    if (traces_.size() == capacity_) {
+        traces_.pop_front();
+        ++dropped_;
+    }
+    traces_.push_back(trace);
+}
+
+void order_trace_log::drain(std::vector<order_trace> &out) {
+    std::lock_guard lock(mutex_);
+    out.insert(out.end(), traces_.begin(), traces_.end());
+    traces_.clear();
+}
+
+std::uint64_t order_trace_log::dropped() const {
+    std::lock_guard lock(mutex_);
+    return dropped_;
+}
+
+} // namespace td365
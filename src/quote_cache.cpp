@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/quote_cache.h>
+
+#include <bit>
+#include <spdlog/spdlog.h>
+
+namespace td365 {
+namespace {
+std::size_t slot_index(int quote_id, std::size_t mask) {
+    // quote ids are dense-ish integers; spread them with a multiplicative hash
+    return (static_cast<std::uint32_t>(quote_id) * 0x9E3779B1U) & mask;
+}
+
+std::int64_t to_ns(tick::time_type t) { return t.time_since_epoch().count(); }
+
+tick::time_type from_ns(std::int64_t ns) {
+    return tick::time_type(std::chrono::nanoseconds(ns));
+}
+} // namespace
+
+quote_cache::quote_cache(std::size_t capacity)
+    : slots_(std::make_unique<slot[]>(std::bit_ceil(capacity))),
+      mask_(std::bit_ceil(capacity) - 1) {}
+
+const quote_cache::slot *quote_cache::find(int quote_id) const {
+    for (std::size_t i = slot_index(quote_id, mask_), n = 0; n <= mask_;
+         i = (i + 1) & mask_, ++n) {
+        auto id = slots_[i].quote_id.load(std::memory_order_acquire);
+        if (id == quote_id) {
+            return &slots_[i];
+        }
+        if (id == 0) {
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+quote_cache::slot *quote_cache::find_or_insert(int quote_id) {
+    for (std::size_t i = slot_index(quote_id, mask_), n = 0; n <= mask_;
+         i = (i + 1) & mask_, ++n) {
+        auto id = slots_[i].quote_id.load(std::memory_order_relaxed);
+        if (id == quote_id) {
+            return &slots_[i];
+        }
+        if (id == 0) {
+            // seq is still 0, so readers see the slot as empty until the
+            // first update completes
+            slots_[i].quote_id.store(quote_id, std::memory_order_release);
+            size_.fetch_add(1, std::memory_order_relaxed);
+            return &slots_[i];
+        }
+    }
+    return nullptr;
+}
+
+void quote_cache::update(const tick &t) {
+    auto *s = find_or_insert(t.quote_id);
+    if (s == nullptr) {
+        if (!full_warned_) {
+            spdlog::warn("quote_cache: full, not caching quote {}", t.quote_id);
+            full_warned_ = true;
+        }
+        return;
+    }
+
+    // single writer: our own view of the slot needs no synchronisation
+    auto seq = s->seq.load(std::memory_order_relaxed);
+    if (seq != 0 && to_ns(t.timestamp) <
+                        s->timestamp.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    s->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s->bid.store(t.bid, std::memory_order_relaxed);
+    s->ask.store(t.ask, std::memory_order_relaxed);
+    s->mid_price.store(t.mid_price, std::memory_order_relaxed);
+    s->timestamp.store(to_ns(t.timestamp), std::memory_order_relaxed);
+    s->received.store(to_ns(t.received), std::memory_order_relaxed);
+    s->seq.store(seq + 2, std::memory_order_release);
+}
+
+std::optional<top_of_book> quote_cache::get(int quote_id) const {
+    const auto *s = find(quote_id);
+    if (s == nullptr) {
+        return std::nullopt;
+    }
+
+    top_of_book r{};
+    r.quote_id = quote_id;
+    for (;;) {
+        auto before = s->seq.load(std::memory_order_acquire);
+        if (before == 0) {
+            return std::nullopt;
+        }
+        if (before & 1U) {
+            continue; // write in progress
+        }
+        r.bid = s->bid.load(std::memory_order_relaxed);
+        r.ask = s->ask.load(std::memory_order_relaxed);
+        r.mid_price = s->mid_price.load(std::memory_order_relaxed);
+        r.timestamp = from_ns(s->timestamp.load(std::memory_order_relaxed));
+        r.received = from_ns(s->received.load(std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s->seq.load(std::memory_order_relaxed) == before) {
+            return r;
+        }
+    }
+}
+
+} // namespace td365
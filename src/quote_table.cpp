@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/quote_table.h>
+
+namespace td365 {
+
+void quote_table::columns::resize(std::size_t n) {
+    quote_id.resize(n);
+    bid.resize(n);
+    ask.resize(n);
+    mid_price.resize(n);
+    high.resize(n);
+    low.resize(n);
+    daily_change.resize(n);
+    timestamp.resize(n);
+}
+
+void quote_table::columns::copy_row(const columns &from, std::size_t row) {
+    quote_id[row] = from.quote_id[row];
+    bid[row] = from.bid[row];
+    ask[row] = from.ask[row];
+    mid_price[row] = from.mid_price[row];
+    high[row] = from.high[row];
+    low[row] = from.low[row];
+    daily_change[row] = from.daily_change[row];
+    timestamp[row] = from.timestamp[row];
+}
+
+quote_table::snapshot::snapshot(snapshot &&other) noexcept
+    : cols_(other.cols_), pin_(other.pin_), version_(other.version_) {
+    other.pin_ = nullptr;
+}
+
+quote_table::snapshot::~snapshot() {
+    if (pin_ != nullptr) {
+        pin_->fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void quote_table::update(const tick &t) {
+    auto [it, inserted] = rows_.try_emplace(t.quote_id, rows_.size());
+    const auto row = it->second;
+    if (inserted) {
+        master_.resize(rows_.size());
+        for (auto &flags : is_dirty_) {
+            flags.resize(rows_.size());
+        }
+    } else if (t.timestamp.time_since_epoch().count() <
+               master_.timestamp[row]) {
+        return;
+    }
+
+    master_.quote_id[row] = t.quote_id;
+    master_.bid[row] = t.bid;
+    master_.ask[row] = t.ask;
+    master_.mid_price[row] = t.mid_price;
+    master_.high[row] = t.high;
+    master_.low[row] = t.low;
+    master_.daily_change[row] = t.daily_change;
+    master_.timestamp[row] = t.timestamp.time_since_epoch().count();
+
+    for (std::size_t b = 0; b < 2; ++b) {
+        if (!is_dirty_[b][row]) {
+            is_dirty_[b][row] = true;
+            dirty_[b].push_back(row);
+        }
+    }
+}
+
+void quote_table::publish() {
+    const auto back = 1 - front_.load(std::memory_order_relaxed);
+    if (dirty_[static_cast<std::size_t>(back)].empty()) {
+        return;
+    }
+    // seq_cst pairs with acquire(): either the reader sees the new front,
+    // or we see its pin and leave the buffer alone
+    auto b = static_cast<std::size_t>(back);
+    if (pins_[b].load(std::memory_order_seq_cst) != 0) {
+        return;
+    }
+
+    auto &cols = buffers_[b];
+    cols.resize(master_.quote_id.size());
+    for (auto row : dirty_[b]) {
+        cols.copy_row(master_, row);
+        is_dirty_[b][row] = false;
+    }
+    dirty_[b].clear();
+
+    versions_[b] = ++published_;
+    front_.store(back, std::memory_order_seq_cst);
+}
+
+quote_table::snapshot quote_table::acquire() const {
+    for (;;) {
+        auto i = front_.load(std::memory_order_seq_cst);
+        auto b = static_cast<std::size_t>(i);
+        pins_[b].fetch_add(1, std::memory_order_seq_cst);
+        if (front_.load(std::memory_order_seq_cst) == i) {
+            return snapshot(&buffers_[b], &pins_[b], versions_[b]);
+        }
+        // lost a race with publish(), which may be writing this buffer
+        pins_[b].fetch_sub(1, std::memory_order_release);
+    }
+}
+
+} // namespace td365
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/resolver.h>
+
+#include <td365/verify.h>
+
+#include <algorithm>
+#include <atomic>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/url/url.hpp>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace td365 {
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace {
+struct cached_answer {
+    tcp::resolver::results_type results;
+    std::chrono::steady_clock::time_point expires;
+};
+
+// td_resolve can be reached from more than one io_context
+std::mutex cache_mutex;
+std::unordered_map<std::string, cached_answer> &cache() {
+    static std::unordered_map<std::string, cached_answer> c;
+    return c;
+}
+
+std::atomic<std::uint64_t> lookups{0};
+std::atomic<std::uint64_t> cache_hits{0};
+
+// Where a connection to host:port actually goes.
+std::pair<std::string, std::string> target(std::string_view host,
+                                           std::string_view port) {
+    if (auto *env = std::getenv("PROXY")) {
+        try {
+            auto u = boost::urls::url{env};
+            return {std::string{u.host()},
+                    u.has_port() ? std::string{u.port()} : "8080"};
+        } catch (const std::exception &e) {
+            throw fail("invalid PROXY environmental: {}", e.what());
+        }
+    }
+    return {std::string{host}, std::string{port}};
+}
+
+std::string cache_key(const std::pair<std::string, std::string> &t) {
+    return t.first + ':' + t.second;
+}
+
+// RFC 8305 section 4: alternate address families, keeping the resolver's
+// order within each and starting with the family it put first.
+std::vector<tcp::endpoint>
+interleave(std::span<const tcp::endpoint> endpoints) {
+    std::vector<tcp::endpoint> first, second;
+    for (const auto &ep : endpoints) {
+        (ep.protocol() == endpoints.front().protocol() ? first : second)
+            .push_back(ep);
+    }
+    std::vector<tcp::endpoint> out;
+    out.reserve(endpoints.size());
+    for (std::size_t i = 0; i < std::max(first.size(), second.size()); ++i) {
+        if (i < first.size()) {
+            out.push_back(first[i]);
+        }
+        if (i < second.size()) {
+            out.push_back(second[i]);
+        }
+    }
+    return out;
+}
+
+struct race {
+    explicit race(const net::any_io_executor &ex)
+        : wake(ex, net::steady_timer::time_point::max()) {}
+
+    std::optional<tcp::socket> winner;
+    std::vector<std::shared_ptr<tcp::socket>> attempts;
+    std::size_t pending = 0;
+    bool signalled = false; // an attempt finished since the last wait
+    boost::system::error_code last_error;
+    net::steady_timer wake;
+};
+
+net::awaitable<void> attempt(std::shared_ptr<race> r,
+                             std::shared_ptr<tcp::socket> socket,
+                             tcp::endpoint ep) {
+    boost::system::error_code ec;
+    co_await socket->async_connect(ep,
+                                   net::redirect_error(net::use_awaitable, ec));
+    --r->pending;
+    if (!ec && !r->winner) {
+        r->winner.emplace(std::move(*socket));
+    } else if (ec && ec != net::error::operation_aborted) {
+        r->last_error = ec;
+    }
+    r->signalled = true;
+    r->wake.cancel();
+}
+
+// Sleeps until `until` or until an attempt finishes.
+net::awaitable<void> wait(std::shared_ptr<race> r,
+                          std::chrono::steady_clock::time_point until) {
+    if (r->signalled) {
+        co_return;
+    }
+    boost::system::error_code ec;
+    r->wake.expires_at(until);
+    co_await r->wake.async_wait(net::redirect_error(net::use_awaitable, ec));
+}
+} // namespace
+
+net::awaitable<tcp::resolver::results_type>
+td_resolve(std::string_view host, std::string_view port,
+           const connect_options &opts) {
+    lookups.fetch_add(1, std::memory_order_relaxed);
+    const auto t = target(host, port);
+    const auto key = cache_key(t);
+    const auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard lock(cache_mutex);
+        if (auto it = cache().find(key);
+            it != cache().end() && it->second.expires > now) {
+            cache_hits.fetch_add(1, std::memory_order_relaxed);
+            co_return it->second.results;
+        }
+    }
+
+    auto resolver = tcp::resolver{co_await net::this_coro::executor};
+    auto results =
+        co_await resolver.async_resolve(t.first, t.second, net::use_awaitable);
+
+    std::lock_guard lock(cache_mutex);
+    cache().insert_or_assign(key, cached_answer{results, now + opts.dns_ttl});
+    co_return results;
+}
+
+void forget_resolved(std::string_view host, std::string_view port) {
+    const auto key = cache_key(target(host, port));
+    std::lock_guard lock(cache_mutex);
+    cache().erase(key);
+}
+
+net::awaitable<tcp::socket>
+race_connect(std::span<const tcp::endpoint> endpoints,
+             const connect_options &opts) {
+    verify(!endpoints.empty(), "race_connect: no endpoints");
+    auto ex = co_await net::this_coro::executor;
+    const auto deadline = std::chrono::steady_clock::now() + opts.timeout;
+    auto r = std::make_shared<race>(ex);
+
+    for (const auto &ep : interleave(endpoints)) {
+        if (r->winner || std::chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+        auto socket = std::make_shared<tcp::socket>(ex);
+        r->attempts.push_back(socket);
+        ++r->pending;
+        r->signalled = false;
+        net::co_spawn(ex, attempt(r, socket, ep), net::detached);
+        // a failure starts the next attempt straight away
+        co_await wait(r, std::min(std::chrono::steady_clock::now() +
+                                      opts.attempt_delay,
+                                  deadline));
+    }
+    while (!r->winner && r->pending > 0 &&
+           std::chrono::steady_clock::now() < deadline) {
+        r->signalled = false;
+        co_await wait(r, deadline);
+    }
+
+    // abandon the losers; their handlers still hold `r`
+    for (auto &socket : r->attempts) {
+        boost::system::error_code ignored;
+        socket->close(ignored);
+    }
+    if (!r->winner) {
+        throw boost::system::system_error(
+            r->last_error ? r->last_error : net::error::timed_out);
+    }
+    co_return std::move(*r->winner);
+}
+
+net::awaitable<tcp::socket> td_connect(std::string_view host,
+                                       std::string_view port,
+                                       const connect_options &opts) {
+    auto results = co_await td_resolve(host, port, opts);
+    std::vector<tcp::endpoint> endpoints;
+    endpoints.reserve(results.size());
+    for (const auto &entry : results) {
+        endpoints.push_back(entry.endpoint());
+    }
+    try {
+        co_return co_await race_connect(endpoints, opts);
+    } catch (const boost::system::system_error &) {
+        forget_resolved(host, port);
+        throw;
+    }
+}
+
+resolver_stats read_resolver_stats() {
+    return {.lookups = lookups.load(std::memory_order_relaxed),
+            .cache_hits = cache_hits.load(std::memory_order_relaxed)};
+}
+
+} // namespace td365
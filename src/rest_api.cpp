@@ -7,15 +7,23 @@
 
 #include <td365/rest_api.h>
 
+#include <td365/candle_cache.h>
 #include <td365/error.h>
 #include <td365/http_client.h>
+#include <td365/json_stream.h>
+#include <td365/order_template.h>
+#include <td365/order_trace.h>
 #include <td365/parsing.h>
 #include <td365/types.h>
 #include <td365/utils.h>
 #include <td365/verify.h>
 
+#include <algorithm>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/beast.hpp>
 #include <nlohmann/json.hpp>
+#include <optional>
 #include <spdlog/spdlog.h>
 
 namespace beast = boost::beast; // from <boost/beast.hpp>
@@ -27,6 +35,10 @@ using json = nlohmann::json;
 using net::awaitable;
 
 static constexpr auto MAX_DEPTH = 4;
+// how often the order connection is checked for having dropped
+static constexpr auto WARM_CHECK_INTERVAL = std::chrono::seconds(1);
+// small, harmless and already used by the web client
+static constexpr auto WARM_TARGET = "/UTSAPI.asmx/GetMarketSuperGroup";
 
 namespace td365 {
     namespace {
@@ -69,17 +81,51 @@ namespace td365 {
         template<typename T>
         auto make_post(http_client *client, std::string_view target,
                        std::optional<std::string> body,
-                       std::optional<http_headers> headers = std::nullopt)
+                       std::optional<http_headers> headers = std::nullopt,
+                       request_timing *timing = nullptr)
             -> net::awaitable<T> {
-            auto resp =
-                    co_await client->post(target, std::move(body), std::move(headers));
-            verify(resp.result() == boost::beast::http::status::ok,
+            auto j = json();
+            auto hdr = co_await client->post_decoded(
+                target, std::move(body),
+                [&](std::string_view b) { j = json::parse(b); },
+                std::move(headers), timing);
+            verify(hdr.result() == boost::beast::http::status::ok,
                    "unexpected response: from {}: {}", target,
-                   static_cast<unsigned>(resp.result()));
-            auto j = json::parse(get_http_body(resp));
+                   static_cast<unsigned>(hdr.result()));
             co_return extract_d<T>(j);
         }
 
+        // Decodes the "d" array of the response record by record as the body
+        // arrives, rather than buffering and parsing the whole document.
+        template<typename T>
+        auto make_post_records(http_client *client, std::string_view target,
+                               std::optional<std::string> body)
+            -> net::awaitable<std::vector<T> > {
+            auto rv = std::vector<T>();
+            auto records = json_array_stream("d", [&](std::string_view e) {
+                rv.push_back(json::parse(e).template get<T>());
+            });
+            auto hdr = co_await client->post_streamed(
+                target, std::move(body),
+                [&](std::string_view chunk) { records.feed(chunk); });
+            verify(hdr.result() == boost::beast::http::status::ok,
+                   "unexpected response: from {}: {}", target,
+                   static_cast<unsigned>(hdr.result()));
+            verify(records.done(), "truncated response from {}", target);
+            co_return rv;
+        }
+
+        // the chart feed sends candles as JSON strings that normally need no
+        // unescaping; fall back to a full parse if one ever does
+        candle parse_candle_element(std::string_view e) {
+            verify(e.size() >= 2 && e.front() == '"' && e.back() == '"',
+                   "unexpected candle: {}", e);
+            if (e.find('\\') != std::string_view::npos) {
+                return parse_candle(json::parse(e).get<std::string>());
+            }
+            return parse_candle(e.substr(1, e.size() - 2));
+        }
+
         // void check_session_status(
         // const boost::beast::http::message<
         // false, boost::beast::http::basic_string_body<char>> &resp) {
@@ -124,7 +170,11 @@ namespace td365 {
 
     auto rest_api::connect(boost::urls::url url) -> awaitable<rest_api::auth_info> {
         auto ex = co_await net::this_coro::executor;
-        client_ = std::make_unique<http_client>(ex, url.host());
+        const auto port = static_cast<unsigned short>(
+            url.has_port() ? std::stoi(std::string(url.port())) : 443);
+        client_ = std::make_unique<http_client>(
+            ex, url.host(),
+            http_client_options{.sockets = sockets_, .port = port});
         spdlog::info("Opening {}", url.buffer());
         auto [ots, login_id] = co_await open_client(url.encoded_target());
         auto token = client_->jar().get(ots);
@@ -141,19 +191,25 @@ namespace td365 {
         client_->default_headers().emplace("Content-Type",
                                            "application/json; charset=utf-8");
         client_->default_headers().emplace("X-Requested-With", "XMLHttpRequest");
+
+        order_client_ = std::make_unique<http_client>(
+            ex, url.host(),
+            http_client_options{
+                .max_connections = 2, .sockets = sockets_, .port = port});
+        order_client_->share_session(*client_);
         co_return auth_info{token.value, login_id};
     }
 
     auto rest_api::get_market_super_group()
         -> awaitable<std::vector<market_group> > {
-        co_return co_await make_post<std::vector<market_group> >(
+        co_return co_await make_post_records<market_group>(
             client_.get(), "/UTSAPI.asmx/GetMarketSuperGroup", std::nullopt);
     }
 
     auto rest_api::get_market_group(int super_group_id)
         -> awaitable<std::vector<market_group> > {
         json body = {{"superGroupId", super_group_id}};
-        co_return co_await make_post<std::vector<market_group> >(
+        co_return co_await make_post_records<market_group>(
             client_.get(), "/UTSAPI.asmx/GetMarketGroup", body.dump());
     }
 
@@ -163,15 +219,21 @@ namespace td365 {
             {"groupID", group_id}, {"keyword", ""}, {"popular", false},
             {"portfolio", false}, {"search", false},
         };
-        co_return co_await make_post<std::vector<market> >(
+        co_return co_await make_post_records<market>(
             client_.get(), "/UTSAPI.asmx/GetMarketQuote", body.dump());
     }
 
     auto rest_api::get_market_details(int market_id)
         -> awaitable<market_details_response> {
         json body = {{"marketID", market_id}};
-        co_return co_await make_post<market_details_response>(
-            client_.get(), get_market_details_url_, body.dump());
+        auto details = co_await make_post<market_details_response>(
+            &order_client(), get_market_details_url_, body.dump());
+        details_.insert_or_assign(
+            market_id,
+            cached_details{details, std::chrono::steady_clock::now()});
+        // an order is likely to follow
+        order_template_for(market_id, details.market_details_data.quote_id);
+        co_return details;
     }
 
     // auto rest_api::get_chart_url(int market_id) -> awaitable<boost::urls::url> {
@@ -180,77 +242,250 @@ namespace td365 {
     // client_.get(), "/UTSAPI.asmx/GetChartURL", body.dump());
     // }
 
+    http_client &rest_api::chart_client(boost::asio::any_io_executor ex) {
+        if (!chart_client_) {
+            // auto chart_url = co_await get_chart_url(market_id);
+            // spdlog::info("chart url: {}", chart_url.buffer());
+            // FIXME
+            chart_client_ = std::make_unique<http_client>(
+                ex, "charts.finsatechnology.com",
+                http_client_options{.sockets = sockets_});
+        }
+        return *chart_client_;
+    }
+
+    http_client &rest_api::order_client() {
+        return order_client_ ? *order_client_ : *client_;
+    }
+
+    auto rest_api::warm_order_path(std::chrono::seconds refresh)
+        -> awaitable<void> {
+        verify(order_client_ != nullptr, "warm_order_path: not connected");
+        auto ex = co_await net::this_coro::executor;
+        warm_timer_ = std::make_unique<net::steady_timer>(ex);
+        while (!warm_stopped_) {
+            try {
+                co_await order_client_->warm(WARM_TARGET, refresh);
+            } catch (const std::exception &e) {
+                spdlog::warn("rest_api: order connection: {}", e.what());
+            }
+            warm_timer_->expires_after(WARM_CHECK_INTERVAL);
+            boost::system::error_code ec;
+            co_await warm_timer_->async_wait(
+                net::redirect_error(net::use_awaitable, ec));
+        }
+    }
+
+    void rest_api::stop_warming() {
+        warm_stopped_ = true;
+        if (warm_timer_) {
+            warm_timer_->cancel();
+        }
+    }
+
+    auto rest_api::fetch_candles(http_client &hc, int market_id, size_t sz)
+        -> awaitable<std::vector<candle> > {
+        auto target = std::format("/data/minute/{}/mid?l={}", market_id, sz);
+        // a market with less history returns fewer than asked for
+        auto rv = std::vector<candle>();
+        rv.reserve(sz);
+        auto data = json_array_stream("data", [&](std::string_view e) {
+            rv.push_back(parse_candle_element(e));
+        });
+        auto hdr = co_await hc.get_streamed(
+            target, [&](std::string_view chunk) { data.feed(chunk); });
+        verify(hdr.result() == http::status::ok,
+               "unexpected response: candles for market {}: {}", market_id,
+               static_cast<unsigned>(hdr.result()));
+        verify(data.done(), "truncated candles for market {}", market_id);
+        std::ranges::sort(rv, {}, &candle::timestamp);
+        co_return rv;
+    }
+
     auto rest_api::backfill(int market_id, int /*quote_id*/, size_t sz,
-                            chart_duration /*dur*/)
+                            chart_duration dur)
         -> awaitable<std::vector<candle> > {
-        // auto chart_url = co_await get_chart_url(market_id);
-        // spdlog::info("chart url: {}", chart_url.buffer());
+        auto &hc = chart_client(co_await net::this_coro::executor);
+        co_return co_await backfill_on(hc, market_id, sz, dur);
+    }
 
-        // FIXME
-        auto hc = http_client(co_await boost::asio::this_coro::executor,
-                              "charts.finsatechnology.com");
-        auto target = std::format("/data/minute/{}/mid?l={}", market_id, sz);
-        auto response = co_await hc.get(target);
-        auto j = json::parse(get_http_body(response));
-        auto data = j.at("data").get<std::vector<std::string> >();
-        auto rv = std::vector<candle>(sz);
-        for (size_t i = 0; i < sz; ++i) {
-            rv[i] = parse_candle(data[i]);
+    auto rest_api::backfill(std::vector<backfill_request> requests,
+                            size_t concurrency,
+                            std::function<void(backfill_result &&)> on_result)
+        -> awaitable<void> {
+        if (requests.empty()) {
+            co_return;
+        }
+        auto ex = co_await net::this_coro::executor;
+
+        // workers share the queue; everything runs on the client's strand
+        // so the counters need no synchronisation
+        size_t next = 0;
+        size_t running = 0;
+        auto all_done = net::steady_timer(ex, net::steady_timer::time_point::max());
+
+        const auto workers = std::clamp<size_t>(concurrency, 1, requests.size());
+        // widen the chart pool for as long as a batch is running
+        auto &hc = chart_client(ex);
+        if (chart_batches_++ == 0) {
+            chart_connections_ = hc.options().max_connections;
+        }
+        hc.options().max_connections =
+                std::max(hc.options().max_connections, workers);
+        for (size_t w = 0; w < workers; ++w) {
+            ++running;
+            net::co_spawn(
+                ex,
+                [&]() -> awaitable<void> {
+                    while (next < requests.size()) {
+                        const auto &r = requests[next++];
+                        auto result = backfill_result{r, {}, nullptr};
+                        try {
+                            result.candles = co_await backfill_on(
+                                hc, r.market_id, r.sz, r.dur);
+                        } catch (...) {
+                            result.error = std::current_exception();
+                        }
+                        try {
+                            on_result(std::move(result));
+                        } catch (const std::exception &e) {
+                            spdlog::error("backfill: on_result: {}", e.what());
+                        }
+                    }
+                },
+                [&](std::exception_ptr) {
+                    if (--running == 0) {
+                        all_done.cancel();
+                    }
+                });
+        }
+
+        if (running > 0) {
+            boost::system::error_code ec;
+            co_await all_done.async_wait(
+                net::redirect_error(net::use_awaitable, ec));
+        }
+        if (--chart_batches_ == 0) {
+            hc.options().max_connections = chart_connections_;
         }
-        co_return rv;
     }
 
-    auto rest_api::trade(const trade_request &request)
-        -> awaitable<trade_response> {
-        json body = {
-            {"marketID", request.market_id},
-            {"quoteID", request.quote_id},
-            {"price", request.price},
-            {"stake", std::to_string(request.stake)},
-            {"tradeType", 1},
-            {"tradeMode", request.dir == trade_request::direction::sell},
-            {"hasClosingOrder", true},
-            {"isGuaranteed", false},
-            {"orderModeID", 3},
-            {"orderTypeID", 2},
-            {"orderPriceModeID", 2},
-            {"limitOrderPrice", std::to_string(request.limit)},
-            {"stopOrderPrice", std::to_string(request.stop)},
-            {"trailingPoint", 0},
-            {"closePositionID", 0},
-            {"isKaazingFeed", true},
-            {"userAgent", "Firefox (139.0)"},
-            {"key", request.key}
+    auto rest_api::backfill_on(http_client &hc, int market_id, size_t sz,
+                               chart_duration dur)
+        -> awaitable<std::vector<candle> > {
+        if (!candles_) {
+            co_return co_await fetch_candles(hc, market_id, sz);
+        }
+
+        // the candles in the newest complete range, which ends at the
+        // latest fetch
+        auto latest = [&] {
+            auto held = candles_->candles(market_id, dur);
+            auto ranges = candles_->ranges(market_id, dur);
+            if (ranges.empty()) {
+                return std::span<const candle>{};
+            }
+            auto from = std::ranges::lower_bound(
+                held, ranges.back().from, {}, &candle::timestamp);
+            auto n = std::min<size_t>(sz, static_cast<size_t>(held.end() - from));
+            return held.last(n);
         };
 
+        const auto now = std::chrono::system_clock::now();
+        auto want = sz;
+        if (auto ranges = candles_->ranges(market_id, dur); !ranges.empty()) {
+            // the periods since the last fetch, plus the one that was still
+            // forming then
+            const auto since = std::max(now - ranges.back().to,
+                                        std::chrono::system_clock::duration{});
+            want = std::min(sz, static_cast<size_t>(since / to_duration(dur)) + 2);
+        }
+
+        candles_->merge(market_id, dur,
+                        co_await fetch_candles(hc, market_id, want), now);
+        if (latest().size() < sz && want < sz) {
+            // the cache did not reach back far enough
+            candles_->merge(market_id, dur,
+                            co_await fetch_candles(hc, market_id, sz), now);
+        }
+
+        auto held = latest();
+        co_return std::vector<candle>(held.begin(), held.end());
+    }
+
+    void rest_api::set_candle_cache(std::unique_ptr<candle_cache> cache) {
+        candles_ = std::move(cache);
+    }
+
+    order_template &rest_api::order_template_for(int market_id, int quote_id) {
+        auto it = templates_.find(market_id);
+        if (it == templates_.end() || it->second.quote_id() != quote_id) {
+            it = templates_.insert_or_assign(
+                market_id, order_template(market_id, quote_id)).first;
+        }
+        return it->second;
+    }
+
+    auto rest_api::trade(const trade_request &request, order_trace *trace)
+        -> awaitable<trade_response> {
+        // rendered into the string that becomes the request body, which
+        // http_client takes over without copying
+        auto body = std::string();
+        order_template_for(request.market_id, request.quote_id)
+            .render(request, body);
+        if (trace != nullptr) {
+            trace->mark(order_stage::trade_sent);
+        }
+        auto timing = request_timing{};
         auto result = co_await make_post<trade_response>(
-            client_.get(), "/UTSAPI.asmx/RequestTrade", body.dump());
+            &order_client(), "/UTSAPI.asmx/RequestTrade",
+            std::move(body), std::nullopt, &timing);
+        if (trace != nullptr) {
+            trace->at[static_cast<size_t>(order_stage::trade_written)] =
+                timing.written;
+            trace->at[static_cast<size_t>(order_stage::first_byte)] =
+                timing.first_byte;
+            trace->mark(order_stage::trade_done);
+        }
         co_return result;
     }
 
-    auto rest_api::sim_trade(const trade_request &request) -> awaitable<void> {
-        json body = {
-            {"marketID", request.market_id},
-            {"quoteID", request.quote_id},
-            {"price", request.price},
-            {"stake", std::to_string(request.stake)},
-            {"tradeType", 1},
-            {"tradeMode", request.dir == trade_request::direction::sell},
-            {"hasClosingOrder", true},
-            {"isGuaranteed", false},
-            {"orderModeID", 3},
-            {"orderTypeID", 2},
-            {"orderPriceModeID", 2},
-            {"limitOrderPrice", std::to_string(request.limit)},
-            {"stopOrderPrice", std::to_string(request.stop)},
-            {"trailingPoint", 0},
-            {"closePositionID", 0},
-            {"isKaazingFeed", true},
-            {"userAgent", "Firefox (139.0)"},
-            {"key", request.key}
+    auto rest_api::place_order(const trade_request &request,
+                               order_trace *trace)
+        -> awaitable<trade_response> {
+        auto mark = [trace](order_stage s) {
+            if (trace != nullptr) {
+                trace->mark(s);
+            }
         };
+        try {
+            auto it = details_.find(request.market_id);
+            if (it == details_.end() ||
+                std::chrono::steady_clock::now() - it->second.fetched >=
+                    order_opts_.details_ttl) {
+                mark(order_stage::details_sent);
+                co_await get_market_details(request.market_id);
+                mark(order_stage::details_done);
+            }
+            if (order_opts_.simulate) {
+                mark(order_stage::simulate_sent);
+                co_await sim_trade(request);
+                mark(order_stage::simulate_done);
+            }
+            co_return co_await trade(request, trace);
+        } catch (...) {
+            // the market's rules may have changed
+            invalidate_market_details(request.market_id);
+            throw;
+        }
+    }
+
+    auto rest_api::sim_trade(const trade_request &request) -> awaitable<void> {
+        auto body = std::string();
+        order_template_for(request.market_id, request.quote_id)
+            .render(request, body);
         co_await make_post<trade_response>(
-            client_.get(), "/UTSAPI.asmx/RequestTradeSimulate", body.dump());
+            &order_client(), "/UTSAPI.asmx/RequestTradeSimulate", std::move(body));
         co_return;
     }
 } // namespace td365
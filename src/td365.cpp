@@ -8,26 +8,94 @@
 #include <td365/td365.h>
 
 #include <td365/authenticator.h>
+#include <td365/candle_cache.h>
+#include <td365/capture.h>
+#include <td365/verify.h>
 #include <td365/ws_client.h>
 
 #include <boost/asio.hpp>
 #include <boost/asio/awaitable.hpp>
 #include <boost/asio/detached.hpp>
 #include <iostream>
+#include <optional>
 #include <print>
 #include <spdlog/spdlog.h>
 
 namespace td365 {
 namespace net = boost::asio; // from <boost/asio.hpp>
 
-td365::td365() : ws_client_(callbacks_), connect_f_(connect_p_.get_future()) {}
+td365::td365()
+    : io_context_(std::make_unique<net::io_context>()),
+      executor_(io_context_->get_executor()), ws_client_(callbacks_),
+      tasks_strand_(executor_), tasks_done_(tasks_strand_) {}
+
+td365::td365(net::any_io_executor executor)
+    : executor_(net::make_strand(std::move(executor))),
+      ws_client_(callbacks_), tasks_strand_(executor_),
+      tasks_done_(tasks_strand_) {}
 
 td365::~td365() {
+    if (io_context_ == nullptr) {
+        // the caller's executor may have stopped, or be running this
+        // destructor, so waiting on it could hang
+        if (const auto n = tasks_.load(); n > 0) {
+            spdlog::error("td365 destroyed with {} task(s) still running; "
+                          "complete async_stop first",
+                          n);
+        }
+        return;
+    }
+    try {
+        stop();
+    } catch (const std::exception &e) {
+        spdlog::error("td365::stop: {}", e.what());
+    }
     if (io_thread_.joinable()) {
+        io_context_->stop();
         io_thread_.join();
     }
 }
 
+void td365::stop() {
+    if (io_context_ != nullptr) {
+        verify(!io_context_->get_executor().running_in_this_thread(),
+               "stop: called on the io thread, use async_stop");
+        if (!io_thread_.joinable() && tasks_.load() == 0) {
+            shutdown_ = true; // nothing has ever run
+            return;
+        }
+        // tasks may be queued before the thread ever started
+        start_io_thread();
+    }
+    async_stop(net::use_future).get();
+}
+
+net::awaitable<void> td365::stop_tasks() {
+    shutdown_ = true;
+    rest_client_.stop_warming();
+    co_await ws_client_.close();
+    // on tasks_strand_, as is every task's completion, so no wake-up is
+    // missed between the check and the wait
+    while (tasks_.load() > 0) {
+        tasks_done_.expires_at(net::steady_timer::time_point::max());
+        boost::system::error_code ec;
+        co_await tasks_done_.async_wait(
+            net::redirect_error(net::use_awaitable, ec));
+    }
+}
+
+void td365::spawn(net::awaitable<void> task) {
+    spawn(std::move(task), net::detached);
+}
+
+void td365::task_done() {
+    net::post(tasks_strand_, [this] {
+        if (--tasks_ == 0) {
+            tasks_done_.cancel();
+        }
+    });
+}
+
 void td365::connect() {
     connect([]() -> net::awaitable<web_detail> {
         return authenticator::authenticate();
@@ -42,33 +110,37 @@ void td365::connect(const std::string &username, const std::string &password,
 }
 
 void td365::connect(std::function<net::awaitable<web_detail>()> auth_fn) {
-    net::co_spawn(
-        io_context_,
-        [&]() -> net::awaitable<void> {
-            try {
-                auto auth_detail = co_await auth_fn();
-                auto [token, login_id] =
-                    co_await rest_client_.connect(auth_detail.platform_url);
-
-                connect_p_.set_value();
-                co_await ws_client_.run(auth_detail.sock_host, login_id, token,
-                                        shutdown_);
-                spdlog::info("message loop exiting");
-            } catch (const std::exception &e) {
-                spdlog::error("ws_client: {}", e.what());
-            } catch (...) {
-                std::println(std::cerr, "ws_client: unknown exception");
-                connect_p_.set_exception(std::current_exception());
-                co_return;
-            }
+    verify(io_context_ != nullptr,
+           "connect: running on the caller's executor, use async_connect");
+    auto connected =
+        net::co_spawn(executor_, start(std::move(auth_fn)), net::use_future);
+    start_io_thread();
+    connected.get();
+}
 
-            co_return;
-        },
-        net::detached);
+net::awaitable<void>
+td365::start(std::function<net::awaitable<web_detail>()> auth_fn) {
+    auto auth_detail = co_await auth_fn();
+    auto [token, login_id] =
+        co_await rest_client_.connect(auth_detail.platform_url);
+    verify(!shutdown_, "connect: stopped");
+    // from here on a trade never pays for connection setup
+    spawn(rest_client_.warm_order_path());
+    spawn(run_feed(auth_detail.sock_host, login_id, token));
+    co_await ws_client_.authenticated();
+}
 
-    start_io_thread();
-    connect_f_.get();
-    ws_client_.wait_for_auth();
+net::awaitable<void> td365::run_feed(boost::urls::url sock_host,
+                                     std::string login_id, std::string token) {
+    try {
+        co_await ws_client_.run(sock_host, login_id, token, shutdown_);
+        spdlog::info("message loop exiting");
+    } catch (const std::exception &e) {
+        spdlog::error("ws_client: {}", e.what());
+    } catch (...) {
+        std::println(std::cerr, "ws_client: unknown exception");
+    }
+    rest_client_.stop_warming();
 }
 
 void td365::start_io_thread() {
@@ -76,7 +148,18 @@ void td365::start_io_thread() {
         return;
     io_thread_ = std::thread([this]() {
         try {
-            io_context_.run();
+            // keeps run() going between tasks; the destructor stops it
+            auto work = net::make_work_guard(*io_context_);
+            pin_thread(profile_.cpu);
+            if (profile_.busy_poll) {
+                // never sleep in epoll_wait
+                while (!io_context_->stopped()) {
+                    wakeups_.mark();
+                    io_context_->poll();
+                }
+            } else {
+                io_context_->run();
+            }
             std::cerr << "io_thread: joining" << std::endl;
         } catch (const std::exception &e) {
             std::cerr << "io_thread: exception: " << e.what() << std::endl;
@@ -86,94 +169,127 @@ void td365::start_io_thread() {
     });
 }
 
-void td365::subscribe(int quote_id) {
-    run_awaitable(ws_client_.subscribe(quote_id));
+void td365::set_network_profile(const network_profile &profile) {
+    profile_ = profile;
+    rest_client_.set_socket_options(profile.sockets);
+    ws_client_.set_socket_options(profile.sockets);
 }
 
-void td365::unsubscribe(int quote_id) {
-    run_awaitable(ws_client_.unsubscribe(quote_id));
+void td365::set_order_options(const order_options &opts) {
+    // orders run on the executor, so change the options there
+    spawn([](rest_api &rest, order_options o) -> net::awaitable<void> {
+        rest.set_order_options(o);
+        co_return;
+    }(rest_client_, opts));
 }
 
-std::vector<market_group> td365::get_market_super_group() {
-    return run_awaitable(rest_client_.get_market_super_group());
+void td365::enable_tick_history(std::size_t capacity, std::size_t max_quotes) {
+    ws_client_.set_tick_history(
+        std::make_unique<tick_history>(capacity, max_quotes));
 }
 
-std::vector<market_group> td365::get_market_group(int id) {
-    return run_awaitable(rest_client_.get_market_group(id));
+const tick_history &td365::history() const {
+    verify(ws_client_.history() != nullptr,
+           "tick history not enabled, call enable_tick_history first");
+    return *ws_client_.history();
 }
 
-std::vector<market> td365::get_market_quote(int id) {
-    return run_awaitable(rest_client_.get_market_quote(id));
+void td365::capture(const std::string &path) {
+    ws_client_.set_capture(std::make_unique<capture_writer>(path));
 }
 
-market_details_response td365::get_market_details(int id) {
-    return run_awaitable((rest_client_.get_market_details(id)));
-}
-void td365::trade(const trade_request &&request) {
-    net::co_spawn(
-        io_context_,
-        [this, request = std::move(request)]() -> net::awaitable<void> {
-            try {
-                co_await rest_client_.get_market_details(request.market_id);
-                co_await rest_client_.sim_trade(request);
-                auto response = co_await rest_client_.trade(std::move(request));
-                callbacks_.trade_response_cb(std::move(response));
-            } catch (const std::exception &e) {
-                spdlog::error("trade exception: {}", e.what());
-            } catch (...) {
-                std::println(std::cerr, "trade: unknown exception");
-            }
+void td365::record_ticks(const std::string &directory,
+                         const tick_store_options &opts) {
+    ws_client_.set_tick_store(std::make_unique<tick_store>(directory, opts));
+}
 
-            co_return;
-        },
-        net::detached);
+void td365::subscribe(int quote_id, grouping g) {
+    async_subscribe(quote_id, g, net::use_future).get();
 }
 
-std::vector<candle> td365::backfill(int market_id, int quote_id, size_t sz,
-                                    chart_duration dur) {
-    return run_awaitable(rest_client_.backfill(market_id, quote_id, sz, dur));
+void td365::unsubscribe(int quote_id, grouping g) {
+    async_unsubscribe(quote_id, g, net::use_future).get();
 }
 
-template <typename Awaitable>
-auto td365::run_awaitable(Awaitable awaitable) ->
-    typename Awaitable::value_type {
+std::vector<market_group> td365::get_market_super_group() {
+    return async_get_market_super_group(net::use_future).get();
+}
 
-    std::promise<typename Awaitable::value_type> promise;
-    auto future = promise.get_future();
+std::vector<market_group> td365::get_market_group(int id) {
+    return async_get_market_group(id, net::use_future).get();
+}
 
-    net::co_spawn(
-        io_context_,
-        [awaitable = std::move(awaitable),
-         &promise]() mutable -> net::awaitable<void> {
-            try {
-                auto result = co_await std::move(awaitable);
-                promise.set_value(std::move(result));
-            } catch (...) {
-                promise.set_exception(std::current_exception());
-            }
-        },
-        net::detached);
+std::vector<market> td365::get_market_quote(int id) {
+    return async_get_market_quote(id, net::use_future).get();
+}
 
-    return future.get();
+market_details_response td365::get_market_details(int id) {
+    return async_get_market_details(id, net::use_future).get();
+}
+std::uint64_t td365::trade(const trade_request &&request) {
+    verify(!shutdown_, "trade: stopped");
+    auto trace = order_trace{.id = next_order_id_.fetch_add(1) + 1,
+                             .market_id = request.market_id,
+                             .quote_id = request.quote_id};
+    trace.mark(order_stage::submitted);
+    const auto id = trace.id;
+    spawn(place(std::move(request), std::move(trace)));
+    return id;
 }
 
-auto td365::run_awaitable(net::awaitable<void> awaitable) -> void {
-    std::promise<void> promise;
-    auto future = promise.get_future();
+net::awaitable<void> td365::place(trade_request order, order_trace trace) {
+    trace.mark(order_stage::started);
+    std::optional<trade_response> response;
+    try {
+        if (order.key.empty()) {
+            const auto *key = ws_client_.order_key(order.quote_id);
+            verify(key != nullptr, "trade: no tick yet for quote {}",
+                   order.quote_id);
+            order.key = *key;
+        }
+        response = co_await rest_client_.place_order(order, &trace);
+        trace.ok = true;
+        trace.mark(order_stage::callback);
+    } catch (const std::exception &e) {
+        spdlog::error("trade exception: {}", e.what());
+    } catch (...) {
+        std::println(std::cerr, "trade: unknown exception");
+    }
+    traces_.push(trace);
+    if (!response) {
+        co_return;
+    }
+    // the order is done; whatever the callback throws is the callback's
+    try {
+        callbacks_.trade_response_cb(std::move(*response));
+    } catch (const std::exception &e) {
+        spdlog::error("trade callback exception: {}", e.what());
+    } catch (...) {
+        std::println(std::cerr, "trade callback: unknown exception");
+    }
+}
 
-    net::co_spawn(
-        io_context_,
-        [awaitable = std::move(awaitable),
-         &promise]() mutable -> net::awaitable<void> {
-            try {
-                co_await std::move(awaitable);
-                promise.set_value();
-            } catch (...) {
-                promise.set_exception(std::current_exception());
-            }
-        },
-        net::detached);
+std::vector<order_trace> td365::drain_order_traces() {
+    auto rv = std::vector<order_trace>();
+    traces_.drain(rv);
+    return rv;
+}
+
+void td365::cache_candles(const std::string &directory) {
+    rest_client_.set_candle_cache(std::make_unique<candle_cache>(directory));
+}
+
+std::vector<candle> td365::backfill(int market_id, int quote_id, size_t sz,
+                                    chart_duration dur) {
+    return async_backfill(market_id, quote_id, sz, dur, net::use_future)
+        .get();
+}
 
-    future.get();
+void td365::backfill(std::vector<backfill_request> requests,
+                     std::function<void(backfill_result &&)> on_result,
+                     size_t concurrency) {
+    async_backfill(std::move(requests), std::move(on_result), concurrency,
+                   net::use_future)
+        .get();
 }
 } // namespace td365
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/tick_history.h>
+
+#include <td365/verify.h>
+
+#include <bit>
+#include <spdlog/spdlog.h>
+
+namespace td365 {
+namespace {
+std::size_t slot_index(int quote_id, std::size_t mask) {
+    return (static_cast<std::uint32_t>(quote_id) * 0x9E3779B1U) & mask;
+}
+} // namespace
+
+tick_history::tick_history(std::size_t capacity, std::size_t max_quotes)
+    : capacity_(capacity), max_quotes_(max_quotes),
+      rings_(std::make_unique<ring[]>(max_quotes)),
+      mask_(std::bit_ceil(max_quotes * 2) - 1),
+      index_(std::make_unique<index_entry[]>(mask_ + 1)) {
+    verify(capacity_ > 0 && max_quotes_ > 0,
+           "tick_history: capacity and max_quotes must be positive");
+    for (std::size_t q = 0; q < max_quotes_; ++q) {
+        auto &r = rings_[q];
+        r.timestamp = std::make_unique<std::atomic<std::int64_t>[]>(capacity_);
+        r.bid = std::make_unique<std::atomic<double>[]>(capacity_);
+        r.ask = std::make_unique<std::atomic<double>[]>(capacity_);
+        r.mid_price = std::make_unique<std::atomic<double>[]>(capacity_);
+    }
+}
+
+const tick_history::ring *tick_history::find(int quote_id) const {
+    for (std::size_t i = slot_index(quote_id, mask_), n = 0; n <= mask_;
+         i = (i + 1) & mask_, ++n) {
+        auto id = index_[i].quote_id.load(std::memory_order_acquire);
+        if (id == quote_id) {
+            return index_[i].r.load(std::memory_order_relaxed);
+        }
+        if (id == 0) {
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+tick_history::ring *tick_history::find_or_insert(int quote_id) {
+    for (std::size_t i = slot_index(quote_id, mask_), n = 0; n <= mask_;
+         i = (i + 1) & mask_, ++n) {
+        auto id = index_[i].quote_id.load(std::memory_order_relaxed);
+        if (id == quote_id) {
+            return index_[i].r.load(std::memory_order_relaxed);
+        }
+        if (id == 0) {
+            if (used_ == max_quotes_) {
+                return nullptr;
+            }
+            index_[i].r.store(&rings_[used_++], std::memory_order_relaxed);
+            index_[i].quote_id.store(quote_id, std::memory_order_release);
+            return index_[i].r.load(std::memory_order_relaxed);
+        }
+    }
+    return nullptr;
+}
+
+void tick_history::record(const tick &t) {
+    auto *r = find_or_insert(t.quote_id);
+    if (r == nullptr) {
+        if (!full_warned_) {
+            spdlog::warn("tick_history: full, not recording quote {}",
+                         t.quote_id);
+            full_warned_ = true;
+        }
+        return;
+    }
+
+    const auto n = r->count.load(std::memory_order_relaxed);
+    const auto ns = to_ns(t.timestamp);
+    if (n > 0 && ns < r->timestamp[(n - 1) % capacity_].load(
+                          std::memory_order_relaxed)) {
+        return; // keep the ring sorted for lookups
+    }
+
+    const auto slot = n % capacity_;
+    r->begin.store(n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    r->timestamp[slot].store(ns, std::memory_order_relaxed);
+    r->bid[slot].store(t.bid, std::memory_order_relaxed);
+    r->ask[slot].store(t.ask, std::memory_order_relaxed);
+    r->mid_price[slot].store(t.mid_price, std::memory_order_relaxed);
+    r->count.store(n + 1, std::memory_order_release);
+}
+
+bool tick_history::load(const ring &r, std::uint64_t i,
+                        tick_sample &out) const {
+    if (i >= r.count.load(std::memory_order_acquire)) {
+        return false;
+    }
+    const auto slot = i % capacity_;
+    out.timestamp = tick::time_type(std::chrono::nanoseconds(
+        r.timestamp[slot].load(std::memory_order_relaxed)));
+    out.bid = r.bid[slot].load(std::memory_order_relaxed);
+    out.ask = r.ask[slot].load(std::memory_order_relaxed);
+    out.mid_price = r.mid_price[slot].load(std::memory_order_relaxed);
+
+    // the writer may have lapped us while we were copying: the slot is only
+    // still sample `i` if no write of sample i + capacity has started
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return r.begin.load(std::memory_order_relaxed) <= i + capacity_;
+}
+
+std::uint64_t tick_history::lower_bound(const ring &r, std::int64_t ns) const {
+    for (;;) {
+        const auto count = r.count.load(std::memory_order_acquire);
+        auto lo = count > capacity_ ? count - capacity_ : 0;
+        auto hi = count;
+        bool lapped = false;
+        while (lo < hi) {
+            const auto mid = lo + (hi - lo) / 2;
+            tick_sample s;
+            if (!load(r, mid, s)) {
+                lapped = true;
+                break;
+            }
+            if (to_ns(s.timestamp) < ns) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (!lapped) {
+            return lo;
+        }
+    }
+}
+
+std::optional<tick_sample> tick_history::at(int quote_id,
+                                            tick::time_type t) const {
+    const auto *r = find(quote_id);
+    if (r == nullptr) {
+        return std::nullopt;
+    }
+    // the sample before the first one strictly after t
+    for (;;) {
+        auto i = lower_bound(*r, to_ns(t) + 1);
+        if (i == 0) {
+            return std::nullopt;
+        }
+        tick_sample s;
+        if (load(*r, i - 1, s)) {
+            return s;
+        }
+        const auto count = r->count.load(std::memory_order_acquire);
+        if (i - 1 < (count > capacity_ ? count - capacity_ : 0)) {
+            return std::nullopt; // older than anything still held
+        }
+    }
+}
+
+std::size_t tick_history::size(int quote_id) const {
+    const auto *r = find(quote_id);
+    if (r == nullptr) {
+        return 0;
+    }
+    const auto count = r->count.load(std::memory_order_acquire);
+    return static_cast<std::size_t>(std::min<std::uint64_t>(count, capacity_));
+}
+
+} // namespace td365
@@ -0,0 +1,577 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/tick_store.h>
+
+#include <td365/verify.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <span>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace td365 {
+namespace {
+constexpr char segment_magic[8] = {'T', 'D', '3', '6', '5', 'T', 'C', 'K'};
+constexpr std::uint32_t segment_version = 1;
+constexpr std::size_t segment_header_size = 16; // magic, version, quote id
+
+constexpr std::uint32_t block_magic = 0x4b4c4254; // "TBLK"
+constexpr std::size_t block_columns = 11;
+// magic, count, decimals, flags, reserved, first timestamp, column sizes
+constexpr std::size_t block_header_size = 4 + 4 + 1 + 1 + 2 + 8 +
+                                          4 * block_columns;
+constexpr std::uint8_t block_has_hash = 1;
+
+constexpr int max_decimals = 8;
+constexpr std::size_t max_hash = 63;
+
+enum column : std::size_t {
+    col_timestamp,
+    col_received,
+    col_bid,
+    col_ask,
+    col_mid,
+    col_high,
+    col_low,
+    col_change,
+    col_flags,
+    col_field13,
+    col_hash
+};
+
+std::uint64_t zigzag(std::int64_t v) {
+    return (static_cast<std::uint64_t>(v) << 1) ^
+           static_cast<std::uint64_t>(v >> 63);
+}
+
+std::int64_t unzigzag(std::uint64_t v) {
+    return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+}
+
+void put_varint(std::vector<std::uint8_t> &out, std::uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(v));
+}
+
+void put_signed(std::vector<std::uint8_t> &out, std::int64_t v) {
+    put_varint(out, zigzag(v));
+}
+
+std::uint64_t get_varint(const std::uint8_t *&p) {
+    std::uint64_t v = 0;
+    for (int shift = 0;; shift += 7) {
+        const auto b = *p++;
+        v |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) {
+            return v;
+        }
+    }
+}
+
+std::int64_t get_signed(const std::uint8_t *&p) {
+    return unzigzag(get_varint(p));
+}
+
+template <typename T> void put_raw(std::uint8_t *dst, T v) {
+    std::memcpy(dst, &v, sizeof(v));
+}
+
+template <typename T> T get_raw(const std::uint8_t *src) {
+    T v;
+    std::memcpy(&v, src, sizeof(v));
+    return v;
+}
+
+std::int64_t to_ns(tick::time_type t) { return t.time_since_epoch().count(); }
+
+// Fewest decimal places that represent every price exactly.
+int decimals_for(std::span<const double> prices) {
+    double scale = 1;
+    for (int d = 0; d < max_decimals; ++d, scale *= 10) {
+        if (std::ranges::all_of(prices, [scale](double v) {
+                const double x = v * scale;
+                return !std::isfinite(x) || std::abs(x - std::round(x)) < 1e-4;
+            })) {
+            return d;
+        }
+    }
+    return max_decimals;
+}
+
+// Walks the block headers of an existing segment and returns the length of
+// its intact prefix, so a block torn by a crash is overwritten, not skipped.
+std::size_t intact_length(int fd, std::size_t size) {
+    std::size_t pos = segment_header_size;
+    std::uint8_t header[block_header_size];
+    while (pos + block_header_size <= size) {
+        if (::pread(fd, header, sizeof(header), static_cast<off_t>(pos)) !=
+                static_cast<ssize_t>(sizeof(header)) ||
+            get_raw<std::uint32_t>(header) != block_magic) {
+            break;
+        }
+        std::size_t len = block_header_size;
+        for (std::size_t c = 0; c < block_columns; ++c) {
+            len += get_raw<std::uint32_t>(header + 20 + 4 * c);
+        }
+        if (pos + len > size) {
+            break;
+        }
+        pos += len;
+    }
+    return std::min(pos, size);
+}
+} // namespace
+
+struct tick_store::record {
+    int quote_id;
+    std::int64_t timestamp;
+    std::int64_t received;
+    double bid;
+    double ask;
+    double daily_change;
+    double high;
+    double low;
+    double mid_price;
+    int field13;
+    std::uint8_t flags;
+    std::uint8_t hash_len;
+    char hash[max_hash];
+};
+
+struct tick_store::segment {
+    int fd = -1;
+    std::int64_t day = 0;
+    // end of the intact blocks, where the next one goes
+    std::size_t size = 0;
+    // a block could not be written or cut back off; drop the rest of the day
+    bool failed = false;
+    std::vector<record> rows;
+
+    segment() = default;
+    segment(const segment &) = delete;
+    segment &operator=(const segment &) = delete;
+    ~segment() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+namespace {
+std::uint8_t pack_flags(const tick &t) {
+    return static_cast<std::uint8_t>(
+        static_cast<unsigned>(t.dir) | (t.tradable ? 1U << 2 : 0) |
+        (t.call_only ? 1U << 3 : 0) | (static_cast<unsigned>(t.group) << 4));
+}
+
+std::int64_t day_of(std::int64_t ns) {
+    const auto t = tick::time_type(std::chrono::nanoseconds(ns));
+    return std::chrono::floor<std::chrono::days>(t).time_since_epoch().count();
+}
+
+void encode_block(std::vector<std::uint8_t> &out,
+                  std::span<const tick_store::record> rows, bool with_hash) {
+    std::vector<double> prices;
+    prices.reserve(rows.size() * 6);
+    for (const auto &r : rows) {
+        prices.insert(prices.end(), {r.bid, r.ask, r.mid_price, r.high, r.low,
+                                     r.daily_change});
+    }
+    const int decimals = decimals_for(prices);
+    const double scale = std::pow(10.0, decimals);
+    auto q = [scale](double v) {
+        return std::isfinite(v) ? std::llround(v * scale) : 0LL;
+    };
+
+    std::vector<std::uint8_t> cols[block_columns];
+    std::int64_t prev_ts = rows.front().timestamp, prev_delta = 0;
+    std::int64_t bid = 0, mid = 0, high = 0, low = 0, change = 0, f13 = 0;
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        const auto &r = rows[i];
+        if (i > 0) {
+            const auto step = r.timestamp - prev_ts;
+            put_signed(cols[col_timestamp], step - prev_delta);
+            prev_ts = r.timestamp;
+            prev_delta = step;
+        }
+        put_signed(cols[col_received], r.received - r.timestamp);
+
+        // each price column is the change from the previous row, except ask
+        // which is stored as the spread over bid
+        auto delta = [](std::int64_t &prev, std::int64_t v) {
+            return v - std::exchange(prev, v);
+        };
+        const auto b = q(r.bid);
+        put_signed(cols[col_bid], delta(bid, b));
+        put_signed(cols[col_ask], q(r.ask) - b);
+        put_signed(cols[col_mid], delta(mid, q(r.mid_price)));
+        put_signed(cols[col_high], delta(high, q(r.high)));
+        put_signed(cols[col_low], delta(low, q(r.low)));
+        put_signed(cols[col_change], delta(change, q(r.daily_change)));
+        cols[col_flags].push_back(r.flags);
+        put_signed(cols[col_field13], delta(f13, r.field13));
+        if (with_hash) {
+            cols[col_hash].push_back(r.hash_len);
+            cols[col_hash].insert(cols[col_hash].end(), r.hash,
+                                  r.hash + r.hash_len);
+        }
+    }
+
+    const auto start = out.size();
+    out.resize(start + block_header_size);
+    auto *h = out.data() + start;
+    put_raw<std::uint32_t>(h, block_magic);
+    put_raw<std::uint32_t>(h + 4, static_cast<std::uint32_t>(rows.size()));
+    h[8] = static_cast<std::uint8_t>(decimals);
+    h[9] = with_hash ? block_has_hash : 0;
+    put_raw<std::uint16_t>(h + 10, 0);
+    put_raw<std::int64_t>(h + 12, rows.front().timestamp);
+    for (std::size_t c = 0; c < block_columns; ++c) {
+        put_raw<std::uint32_t>(out.data() + start + 20 + 4 * c,
+                               static_cast<std::uint32_t>(cols[c].size()));
+    }
+    for (const auto &c : cols) {
+        out.insert(out.end(), c.begin(), c.end());
+    }
+}
+} // namespace
+
+tick_store::tick_store(std::string directory, tick_store_options opts)
+    : directory_(std::move(directory)), opts_(opts),
+      queue_(std::make_unique<record[]>(std::bit_ceil(opts.queue_capacity))),
+      mask_(std::bit_ceil(opts.queue_capacity) - 1) {
+    verify(opts_.block_ticks > 0 && opts_.queue_capacity > 0,
+           "tick_store: block_ticks and queue_capacity must be positive");
+    std::filesystem::create_directories(directory_);
+    writer_ = std::thread([this] { run(); });
+}
+
+tick_store::~tick_store() {
+    stop_.store(true, std::memory_order_release);
+    writer_.join();
+}
+
+std::string tick_store::segment_path(const std::string &directory,
+                                     int quote_id, tick::time_type day) {
+    const std::chrono::year_month_day ymd{
+        std::chrono::floor<std::chrono::days>(day)};
+    return std::format("{}/{}/{:04}-{:02}-{:02}.ticks", directory, quote_id,
+                       static_cast<int>(ymd.year()),
+                       static_cast<unsigned>(ymd.month()),
+                       static_cast<unsigned>(ymd.day()));
+}
+
+bool tick_store::append(const tick &t) {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) > mask_) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    auto &r = queue_[tail & mask_];
+    r.quote_id = t.quote_id;
+    r.timestamp = to_ns(t.timestamp);
+    r.received = to_ns(t.received);
+    r.bid = t.bid;
+    r.ask = t.ask;
+    r.daily_change = t.daily_change;
+    r.high = t.high;
+    r.low = t.low;
+    r.mid_price = t.mid_price;
+    r.field13 = t.field13;
+    r.flags = pack_flags(t);
+    r.hash_len = 0;
+    if (opts_.store_hash) {
+        r.hash_len =
+            static_cast<std::uint8_t>(std::min(t.hash.size(), max_hash));
+        std::memcpy(r.hash, t.hash.data(), r.hash_len);
+    }
+
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+void tick_store::run() {
+    std::unordered_map<int, segment> segments;
+    std::vector<std::uint8_t> buf;
+    auto last_flush = std::chrono::steady_clock::now();
+
+    auto write_block = [&](int quote_id, segment &s) {
+        if (s.rows.empty()) {
+            return;
+        }
+        buf.clear();
+        encode_block(buf, s.rows, opts_.store_hash);
+        s.rows.clear();
+        if (s.fd < 0 || s.failed) {
+            return; // already logged
+        }
+        const auto n = ::pwrite(s.fd, buf.data(), buf.size(),
+                                static_cast<off_t>(s.size));
+        if (n == static_cast<ssize_t>(buf.size())) {
+            s.size += buf.size();
+            return;
+        }
+        spdlog::error("tick_store: write quote {}: {}", quote_id,
+                      n < 0 ? std::strerror(errno) : "short write");
+        // a torn block left in place would end the segment for readers, and
+        // hide every block written after it
+        if (::ftruncate(s.fd, static_cast<off_t>(s.size)) != 0) {
+            spdlog::error("tick_store: ftruncate quote {}: {}, not writing "
+                          "to its segment again today",
+                          quote_id, std::strerror(errno));
+            s.failed = true;
+        }
+    };
+
+    auto open = [&](int quote_id, std::int64_t day) -> segment & {
+        auto &s = segments[quote_id];
+        if (s.fd >= 0 && s.day == day) {
+            return s;
+        }
+        write_block(quote_id, s);
+        if (s.fd >= 0) {
+            ::close(s.fd);
+            s.fd = -1;
+        }
+        s.day = day;
+        s.failed = false;
+        s.rows.reserve(opts_.block_ticks);
+
+        const auto path = segment_path(
+            directory_, quote_id,
+            tick::time_type(std::chrono::days(day)));
+        std::error_code ec;
+        std::filesystem::create_directories(
+            std::filesystem::path(path).parent_path(), ec);
+        s.fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (s.fd < 0) {
+            spdlog::error("tick_store: open {}: {}", path,
+                          std::strerror(errno));
+            return s;
+        }
+
+        struct stat st {};
+        if (::fstat(s.fd, &st) != 0) {
+            // an unknown size must not be mistaken for a new segment
+            spdlog::error("tick_store: fstat {}: {}, not writing to it today",
+                          path, std::strerror(errno));
+            s.failed = true;
+            return s;
+        }
+        auto size = static_cast<std::size_t>(st.st_size);
+        if (size < segment_header_size) {
+            std::uint8_t header[segment_header_size];
+            std::memcpy(header, segment_magic, sizeof(segment_magic));
+            put_raw<std::uint32_t>(header + 8, segment_version);
+            put_raw<std::int32_t>(header + 12, quote_id);
+            if (::ftruncate(s.fd, 0) != 0 ||
+                ::pwrite(s.fd, header, sizeof(header), 0) !=
+                    static_cast<ssize_t>(sizeof(header))) {
+                spdlog::error("tick_store: {}: {}", path, std::strerror(errno));
+            }
+            size = segment_header_size;
+        } else {
+            const auto intact = intact_length(s.fd, size);
+            if (intact != size) {
+                spdlog::warn("tick_store: {}: dropping {} bytes of torn block",
+                             path, size - intact);
+                if (::ftruncate(s.fd, static_cast<off_t>(intact)) != 0) {
+                    spdlog::error("tick_store: ftruncate {}: {}", path,
+                                  std::strerror(errno));
+                }
+            }
+            size = intact;
+        }
+        s.size = size;
+        return s;
+    };
+
+    for (;;) {
+        const bool stopping = stop_.load(std::memory_order_acquire);
+        const auto tail = tail_.load(std::memory_order_acquire);
+        auto head = head_.load(std::memory_order_relaxed);
+
+        for (; head != tail; ++head) {
+            const auto &r = queue_[head & mask_];
+            auto &s = open(r.quote_id, day_of(r.timestamp));
+            s.rows.push_back(r);
+            if (s.rows.size() >= opts_.block_ticks) {
+                write_block(r.quote_id, s);
+            }
+            head_.store(head + 1, std::memory_order_release);
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (stopping || now - last_flush >= opts_.flush_interval) {
+            for (auto &[quote_id, s] : segments) {
+                write_block(quote_id, s);
+            }
+            last_flush = now;
+        }
+        if (stopping) {
+            break;
+        }
+        if (head == tail) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+tick_segment_reader::tick_segment_reader(const std::string &path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    verify(fd_ >= 0, "tick_segment_reader: open {}: {}", path,
+           std::strerror(errno));
+
+    struct stat st {};
+    if (::fstat(fd_, &st) != 0) {
+        ::close(fd_);
+        throw fail("tick_segment_reader: fstat {}: {}", path,
+                   std::strerror(errno));
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+
+    if (size_ < segment_header_size) {
+        ::close(fd_);
+        throw fail("tick_segment_reader: {} is not a tick segment", path);
+    }
+
+    void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (p == MAP_FAILED) {
+        ::close(fd_);
+        throw fail("tick_segment_reader: mmap {}: {}", path,
+                   std::strerror(errno));
+    }
+    base_ = static_cast<const std::uint8_t *>(p);
+    ::madvise(const_cast<std::uint8_t *>(base_), size_, MADV_SEQUENTIAL);
+
+    if (std::memcmp(base_, segment_magic, sizeof(segment_magic)) != 0 ||
+        get_raw<std::uint32_t>(base_ + 8) != segment_version) {
+        ::munmap(const_cast<std::uint8_t *>(base_), size_);
+        ::close(fd_);
+        throw fail("tick_segment_reader: {}: bad header", path);
+    }
+    quote_id_ = get_raw<std::int32_t>(base_ + 12);
+    rewind();
+}
+
+tick_segment_reader::~tick_segment_reader() {
+    if (base_ != nullptr) {
+        ::munmap(const_cast<std::uint8_t *>(base_), size_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void tick_segment_reader::rewind() {
+    block_end_ = segment_header_size;
+    remaining_ = 0;
+}
+
+bool tick_segment_reader::open_block() {
+    const auto pos = block_end_;
+    if (pos + block_header_size > size_) {
+        return false;
+    }
+    const auto *h = base_ + pos;
+    if (get_raw<std::uint32_t>(h) != block_magic) {
+        return false;
+    }
+
+    std::size_t len = block_header_size;
+    std::uint32_t sizes[block_columns];
+    for (std::size_t c = 0; c < block_columns; ++c) {
+        sizes[c] = get_raw<std::uint32_t>(h + 20 + 4 * c);
+        len += sizes[c];
+    }
+    if (pos + len > size_) {
+        return false; // torn by a crash mid-write
+    }
+
+    const auto *p = h + block_header_size;
+    for (std::size_t c = 0; c < block_columns; ++c) {
+        col_[c] = p;
+        p += sizes[c];
+    }
+
+    block_end_ = pos + len;
+    remaining_ = get_raw<std::uint32_t>(h + 4);
+    scale_ = std::pow(10.0, h[8]);
+    has_hash_ = (h[9] & block_has_hash) != 0;
+    ts_ = get_raw<std::int64_t>(h + 12);
+    delta_ = 0;
+    first_ = true;
+    bid_ = mid_ = high_ = low_ = change_ = field13_ = 0;
+    return remaining_ > 0;
+}
+
+bool tick_segment_reader::next(stored_tick &out) {
+    while (remaining_ == 0) {
+        if (!open_block()) {
+            return false;
+        }
+    }
+    --remaining_;
+
+    if (!first_) {
+        delta_ += get_signed(col_[col_timestamp]);
+        ts_ += delta_;
+    }
+    first_ = false;
+
+    bid_ += get_signed(col_[col_bid]);
+    mid_ += get_signed(col_[col_mid]);
+    high_ += get_signed(col_[col_high]);
+    low_ += get_signed(col_[col_low]);
+    change_ += get_signed(col_[col_change]);
+    field13_ += get_signed(col_[col_field13]);
+    const auto ask = bid_ + get_signed(col_[col_ask]);
+    const auto flags = *col_[col_flags]++;
+
+    out.quote_id = quote_id_;
+    out.timestamp = tick::time_type(std::chrono::nanoseconds(ts_));
+    out.received = tick::time_type(
+        std::chrono::nanoseconds(ts_ + get_signed(col_[col_received])));
+    out.bid = static_cast<double>(bid_) / scale_;
+    out.ask = static_cast<double>(ask) / scale_;
+    out.mid_price = static_cast<double>(mid_) / scale_;
+    out.high = static_cast<double>(high_) / scale_;
+    out.low = static_cast<double>(low_) / scale_;
+    out.daily_change = static_cast<double>(change_) / scale_;
+    out.dir = static_cast<direction>(flags & 3);
+    out.tradable = (flags & (1U << 2)) != 0;
+    out.call_only = (flags & (1U << 3)) != 0;
+    out.group = static_cast<grouping>(flags >> 4);
+    out.field13 = static_cast<int>(field13_);
+    out.hash = {};
+    if (has_hash_) {
+        const auto len = *col_[col_hash]++;
+        out.hash = std::string_view(
+            reinterpret_cast<const char *>(col_[col_hash]), len);
+        col_[col_hash] += len;
+    }
+    return true;
+}
+
+} // namespace td365
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/timestamped_stream.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <spdlog/spdlog.h>
+#include <sys/socket.h>
+
+namespace td365 {
+
+bool timestamped_stream::enable_timestamps() {
+    int one = 1;
+    if (::setsockopt(stream_.socket().native_handle(), SOL_SOCKET,
+                     SO_TIMESTAMPNS, &one, sizeof(one)) != 0) {
+        spdlog::warn("SO_TIMESTAMPNS: {}", std::strerror(errno));
+        return false;
+    }
+    timestamps_ = true;
+    return true;
+}
+
+void timestamped_stream::expires_after(
+    std::chrono::steady_clock::duration timeout) {
+    stream_.expires_after(timeout);
+    // also cancels the previous deadline's wait
+    timer_.expires_after(timeout);
+    if (!timestamps_) {
+        return;
+    }
+    timer_.async_wait([this](boost::system::error_code ec) {
+        if (!ec) {
+            // as tcp_stream does on a timeout
+            boost::system::error_code ignored;
+            stream_.socket().close(ignored);
+        }
+    });
+}
+
+std::size_t timestamped_stream::receive(iovec *iov, std::size_t count,
+                                        boost::system::error_code &ec) {
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(timespec))];
+
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n;
+    do {
+        n = ::recvmsg(stream_.socket().native_handle(), &msg, MSG_DONTWAIT);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            ec = boost::asio::error::would_block;
+        } else {
+            ec = boost::system::error_code(errno,
+                                           boost::system::system_category());
+        }
+        return 0;
+    }
+    if (n == 0) {
+        ec = boost::asio::error::eof;
+        return 0;
+    }
+
+    ec = {};
+    for (auto *c = CMSG_FIRSTHDR(&msg); c != nullptr; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+            timespec ts;
+            std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+            last_received_ = time_type(std::chrono::seconds(ts.tv_sec) +
+                                       std::chrono::nanoseconds(ts.tv_nsec));
+        }
+    }
+    return static_cast<std::size_t>(n);
+}
+
+void teardown(boost::beast::role_type role, timestamped_stream &stream,
+              boost::system::error_code &ec) {
+    using boost::beast::websocket::teardown;
+    teardown(role, stream.next_layer(), ec);
+}
+
+} // namespace td365
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/tls.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace td365 {
+namespace {
+using session_ptr = std::unique_ptr<SSL_SESSION, decltype(&SSL_SESSION_free)>;
+
+// handshakes can run on more than one thread, e.g. a facade call racing
+// the io thread
+std::mutex sessions_mutex;
+std::unordered_map<std::string, session_ptr> &sessions() {
+    static std::unordered_map<std::string, session_ptr> s;
+    return s;
+}
+
+std::atomic<std::uint64_t> handshakes{0};
+std::atomic<std::uint64_t> resumed{0};
+
+// Called by OpenSSL whenever the server issues a session: after a full
+// handshake under TLS 1.2, or on each ticket under TLS 1.3.
+int on_new_session(SSL *ssl, SSL_SESSION *session) {
+    const char *host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    if (host == nullptr) {
+        return 0;
+    }
+    // keep a copy: OpenSSL marks a connection's own session unresumable
+    // when it closes without a TLS shutdown, which pooled and dropped
+    // connections do
+    session_ptr copy(SSL_SESSION_dup(session), &SSL_SESSION_free);
+    if (copy) {
+        std::lock_guard lock(sessions_mutex);
+        sessions().insert_or_assign(host, std::move(copy));
+    }
+    return 0; // OpenSSL keeps ownership of `session`
+}
+} // namespace
+
+void enable_tls_session_cache(SSL_CTX *ctx) {
+    // the internal store is keyed by session ID, not host, so is no use to
+    // a client
+    SSL_CTX_set_session_cache_mode(
+        ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, on_new_session);
+}
+
+void offer_tls_session(SSL *ssl, const std::string &host) {
+    std::lock_guard lock(sessions_mutex);
+    auto it = sessions().find(host);
+    if (it == sessions().end()) {
+        return;
+    }
+    if (SSL_SESSION_is_resumable(it->second.get()) != 1) {
+        sessions().erase(it);
+        return;
+    }
+    // each connection gets its own copy for the same reason
+    session_ptr copy(SSL_SESSION_dup(it->second.get()), &SSL_SESSION_free);
+    if (copy) {
+        SSL_set_session(ssl, copy.get());
+    }
+}
+
+void record_tls_handshake(SSL *ssl) {
+    handshakes.fetch_add(1, std::memory_order_relaxed);
+    if (SSL_session_reused(ssl) == 1) {
+        resumed.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+tls_stats read_tls_stats() {
+    return {.handshakes = handshakes.load(std::memory_order_relaxed),
+            .resumed = resumed.load(std::memory_order_relaxed)};
+}
+
+} // namespace td365
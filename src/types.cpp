@@ -180,7 +180,9 @@ void to_json(nlohmann::json &j, const tick &m) {
                        {"timestamp", m.timestamp.time_since_epoch().count()},
                        {"field13", m.field13},
                        {"group", m.group},
-                       {"latency", m.latency.count()}};
+                       {"latency", m.latency.count()},
+                       {"received", m.received.time_since_epoch().count()},
+                       {"decoded", m.decoded.time_since_epoch().count()}};
 }
 
 void from_json(const nlohmann::json &j, tick &m) {
@@ -203,6 +205,10 @@ void from_json(const nlohmann::json &j, tick &m) {
     j.at("group").get_to(m.group);
     auto latency_count = j.at("latency").get<long long>();
     m.latency = std::chrono::nanoseconds(latency_count);
+    m.received = tick::time_type(
+        std::chrono::nanoseconds(j.value("received", 0LL)));
+    m.decoded = tick::time_type(
+        std::chrono::nanoseconds(j.value("decoded", 0LL)));
 }
 
 void to_json(nlohmann::json &j, request_trade_simulate const &r) {
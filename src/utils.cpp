@@ -9,15 +9,13 @@
 
 #include "base64.hpp"
 #include <td365/http_client.h>
+#include <td365/inflate.h>
+#include <td365/tls.h>
 #include "nlohmann/json.hpp"
 
 #include <boost/asio/ssl.hpp>
-#include <boost/beast/core/buffers_to_string.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
-#include <boost/iostreams/copy.hpp>
-#include <boost/iostreams/device/array.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
+#include <algorithm>
 #include <charconv>
 #include <fstream>
 #include <regex>
@@ -40,6 +38,7 @@ namespace td365 {
                     out << line << std::endl;
                 });
             rv.set_default_verify_paths();
+            enable_tls_session_cache(rv.native_handle());
             return rv;
         }();
         return ctx;
@@ -84,42 +83,49 @@ namespace td365 {
         return rv; // see NVRO
     }
 
-    std::string get_http_body(http_response const &res) {
-        auto body = beast::buffers_to_string(res.body().data());
-        if (res[beast::http::field::content_encoding] == "gzip") {
-            auto const src =
-                    boost::iostreams::array_source{body.data(), body.size()};
-            auto is = boost::iostreams::filtering_istream{};
-            auto os = std::stringstream{};
-            is.push(boost::iostreams::gzip_decompressor{});
-            is.push(src);
-            boost::iostreams::copy(is, os);
-            body = os.str();
+    namespace {
+        // gzip ends with the uncompressed size mod 2^32, which is exact for
+        // any body under the client's size limit. Bounded by deflate's best
+        // possible ratio in case the trailer is not what it seems.
+        std::size_t gzip_size_hint(std::string_view gz) {
+            if (gz.size() < 18) {
+                return 0;
+            }
+            const auto *tail =
+                    reinterpret_cast<const unsigned char *>(gz.data() + gz.size() - 4);
+            const auto size = static_cast<std::size_t>(tail[0]) |
+                              static_cast<std::size_t>(tail[1]) << 8U |
+                              static_cast<std::size_t>(tail[2]) << 16U |
+                              static_cast<std::size_t>(tail[3]) << 24U;
+            return std::min(size, gz.size() * 1032);
         }
-        return body;
-    }
+    } // namespace
 
-    boost::asio::awaitable<boost::asio::ip::tcp::resolver::results_type>
-    td_resolve(std::string_view host, std::string_view port) {
-        auto executor = co_await boost::asio::this_coro::executor;
-        auto resolver = boost::asio::ip::tcp::resolver{executor};
+    std::string_view get_http_body(http_response const &res, std::string &buffer) {
+        const std::string_view body = res.body();
+        if (res[beast::http::field::content_encoding] != "gzip") {
+            return body;
+        }
 
-        std::string h, p;
+        // inflateReset keeps zlib's state allocations from one response to
+        // the next
+        thread_local gzip_inflater inflater;
+        inflater.reset();
+        std::size_t used = 0;
+        buffer.resize(std::max<std::size_t>(gzip_size_hint(body), 1));
+        inflater.feed(body, buffer, used);
+        verify(inflater.done(), "get_http_body: truncated gzip body");
+        return {buffer.data(), used};
+    }
 
-        if (auto *env = std::getenv("PROXY")) {
-            try {
-                auto u = boost::urls::url{env};
-                h = std::string{u.host()};
-                p = u.has_port() ? u.port() : "8080";
-            } catch (const std::exception &e) {
-                throw fail("invalid PROXY environmental: {}", e.what());
-            }
+    std::string get_http_body(http_response const &res) {
+        auto body = std::string();
+        const auto view = get_http_body(res, body);
+        if (view.data() == body.data()) {
+            body.resize(view.size());
         } else {
-            h = host;
-            p = port;
+            body.assign(view);
         }
-
-        auto ep = co_await resolver.async_resolve(h, p, boost::asio::use_awaitable);
-        co_return ep;
+        return body;
     }
 } // namespace td365
@@ -8,6 +8,9 @@
 #include <td365/ws.h>
 
 #include <td365/constants.h>
+#include <td365/net_profile.h>
+#include <td365/resolver.h>
+#include <td365/tls.h>
 #include <td365/utils.h>
 
 #include <boost/asio/detached.hpp>
@@ -35,7 +38,8 @@ namespace td365 {
         return enabled;
     }
 
-    ws::ws() : using_ssl_(false) {
+    ws::ws(const socket_options &sockets)
+        : using_ssl_(false), sockets_(sockets) {
     }
 
     boost::asio::awaitable<void> ws::connect(boost::urls::url url) {
@@ -44,17 +48,18 @@ namespace td365 {
         // Determine if we should use SSL based on the URL scheme
         using_ssl_ = (url.scheme() == "wss" || url.scheme() == "https");
 
-        auto const ep = co_await td_resolve(url.host(), (using_ssl_ ? "443" : "80"));
+        auto const port = url.has_port()
+                              ? std::string{url.port()}
+                              : std::string{using_ssl_ ? "443" : "80"};
 
         if (using_ssl_) {
             // Create SSL WebSocket
             ssl_ws_ = std::make_unique<ssl_websocket_type>(executor, ssl_ctx());
 
-            // Set a timeout on the operation
-            beast::get_lowest_layer(*ssl_ws_).expires_after(
-                std::chrono::seconds(30));
-
-            co_await beast::get_lowest_layer(*ssl_ws_).async_connect(ep, use_awaitable);
+            beast::get_lowest_layer(*ssl_ws_).socket() =
+                    co_await td_connect(url.host(), port);
+            apply_socket_options(beast::get_lowest_layer(*ssl_ws_).socket(),
+                                 sockets_);
 
             // Set SNI Hostname (many hosts need this to handshake successfully)
             if (!SSL_set_tlsext_host_name(ssl_ws_->next_layer().native_handle(),
@@ -62,6 +67,8 @@ namespace td365 {
                 throw beast::system_error(static_cast<int>(::ERR_get_error()),
                                           net::error::get_ssl_category());
             }
+            offer_tls_session(ssl_ws_->next_layer().native_handle(),
+                              url.host());
 
             // Set a timeout on the operation
             beast::get_lowest_layer(*ssl_ws_).expires_after(
@@ -76,6 +83,7 @@ namespace td365 {
             // Perform the SSL handshake
             co_await ssl_ws_->next_layer().async_handshake(
                 ssl::stream_base::client, use_awaitable);
+            record_tls_handshake(ssl_ws_->next_layer().native_handle());
 
             // Turn off the timeout on the tcp_stream, because
             // the websocket stream has its own timeout system.
@@ -92,11 +100,10 @@ namespace td365 {
             // Create plain WebSocket
             plain_ws_ = std::make_unique<plain_websocket_type>(executor);
 
-            // Set a timeout on the operation
-            beast::get_lowest_layer(*plain_ws_)
-                    .expires_after(std::chrono::seconds(30));
-
-            co_await beast::get_lowest_layer(*plain_ws_).async_connect(ep, use_awaitable);
+            beast::get_lowest_layer(*plain_ws_).socket() =
+                    co_await td_connect(url.host(), port);
+            apply_socket_options(beast::get_lowest_layer(*plain_ws_).socket(),
+                                 sockets_);
 
             // Set a decorator to change the User-Agent of the handshake
             plain_ws_->set_option(
@@ -117,16 +124,25 @@ namespace td365 {
                                                 use_awaitable);
         }
 
+        // Only now, so tcp_stream's timeouts still cover the handshakes
+        transport().enable_timestamps();
+
         co_return;
     }
 
+    timestamped_stream &ws::transport() {
+        return using_ssl_ ? ssl_ws_->next_layer().next_layer()
+                          : plain_ws_->next_layer();
+    }
+
     boost::asio::awaitable<void> ws::close() {
+        // on the transport: with timestamps on, the tcp_stream's timer
+        // doesn't bound the reads waiting for the close frame
+        transport().expires_after(std::chrono::seconds(1));
         if (using_ssl_) {
-            get_lowest_layer(*ssl_ws_).expires_after(std::chrono::seconds(1));
             co_await ssl_ws_->async_close(
                 boost::beast::websocket::close_code::normal, use_awaitable);
         } else {
-            get_lowest_layer(*plain_ws_).expires_after(std::chrono::seconds(1));
             co_await plain_ws_->async_close(
                 boost::beast::websocket::close_code::normal, use_awaitable);
         }
@@ -162,6 +178,10 @@ namespace td365 {
         if (ec) {
             co_return std::make_pair(ec, std::string{});
         }
+        record_read();
+        received_ = transport().timestamps_enabled()
+                        ? transport().last_received()
+                        : std::chrono::system_clock::now();
 
         std::string buf(static_cast<const char *>(buffer.cdata().data()),
                         buffer.cdata().size());
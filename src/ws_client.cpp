@@ -7,13 +7,17 @@
 
 #include <td365/ws_client.h>
 
+#include <td365/capture.h>
 #include <td365/parsing.h>
 #include <td365/td365.h>
+#include <td365/tick_store.h>
 #include <td365/utils.h>
+#include <td365/verify.h>
 #include <td365/ws.h>
 
 #include <algorithm>
 #include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
 #include <boost/asio/ssl.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <boost/lexical_cast.hpp>
@@ -43,6 +47,7 @@ enum class payload_type {
     account_details
 };
 
+namespace {
 payload_type string_to_payload_type(std::string_view str) {
     static const std::unordered_map<std::string_view, payload_type> lookup = {
         {"heartbeat", payload_type::heartbeat},
@@ -66,6 +71,14 @@ bool is_error_continuable(const boost::system::error_code &ec) {
     return false;
 }
 
+nlohmann::json subscription_request(int quote_id, grouping g,
+                                    std::string_view action) {
+    return {{"quoteId", quote_id},
+            {"priceGrouping", to_string(g)},
+            {"action", action}};
+}
+} // namespace
+
 ws_client::ws_client(const user_callbacks &callbacks)
     : callbacks_(callbacks), auth_f_(auth_p_.get_future()) {}
 
@@ -91,28 +104,24 @@ ws_client::~ws_client() {
 
 boost::asio::awaitable<void> ws_client::connect(boost::urls::url_view u) {
     spdlog::info("ws_client: connecting to {}", u.buffer());
-    ws_ = std::make_unique<ws>();
+    ws_ = std::make_unique<ws>(sockets_);
     return ws_->connect(u);
 }
 
-boost::asio::awaitable<void> ws_client::subscribe(int quote_id) {
-    if (std::ranges::find(subscribed_, quote_id) ==
-        std::ranges::end(subscribed_)) {
-        subscribed_.push_back(quote_id);
-        co_await send({{"quoteId", quote_id},
-                       {"priceGrouping", "Sampled"},
-                       {"action", "subscribe"}});
+boost::asio::awaitable<void> ws_client::subscribe(int quote_id, grouping g) {
+    const auto key = std::make_pair(quote_id, g);
+    if (std::ranges::find(subscribed_, key) == std::ranges::end(subscribed_)) {
+        subscribed_.push_back(key);
+        co_await send(subscription_request(quote_id, g, "subscribe"));
     }
     co_return;
 }
 
-boost::asio::awaitable<void> ws_client::unsubscribe(int quote_id) {
-    auto pos = std::ranges::find(subscribed_, quote_id);
+boost::asio::awaitable<void> ws_client::unsubscribe(int quote_id, grouping g) {
+    auto pos = std::ranges::find(subscribed_, std::make_pair(quote_id, g));
     if (pos != std::ranges::end(subscribed_)) {
         subscribed_.erase(pos);
-        co_await send({{"quoteId", quote_id},
-                       {"priceGrouping", "Sampled"},
-                       {"action", "unsubscribe"}});
+        co_await send(subscription_request(quote_id, g, "unsubscribe"));
     }
     co_return;
 }
@@ -134,15 +143,22 @@ ws_client::message_loop(const std::string &login_id, const std::string &token,
                 // FIXME
                 auth_p_ = std::promise<void>();
                 auth_f_ = auth_p_.get_future();
+                authenticated_ = false;
                 co_return;
             }
             spdlog::info("ws_client::message_loop: not continuable");
             throw ec;
         }
 
+        const auto received = ws_->last_received();
+        if (capture_) {
+            capture_->append(received, buf);
+        }
+
         auto msg = nlohmann::json::parse(buf);
+        auto type = string_to_payload_type(msg["t"].get<std::string>());
 
-        switch (string_to_payload_type(msg["t"].get<std::string>())) {
+        switch (type) {
         case payload_type::connect_response:
             co_await process_connect_response(msg, login_id, token);
             break;
@@ -155,26 +171,59 @@ ws_client::message_loop(const std::string &login_id, const std::string &token,
         case payload_type::authentication_response:
             co_await process_authentication_response(msg);
             break;
-        case payload_type::subscribe_response:
-            process_subscribe_response(msg);
-            break;
-        case payload_type::price_data:
-            process_price_data(msg);
-            break;
-        case payload_type::account_summary:
-            process_account_summary(msg);
-            break;
-        case payload_type::account_details:
-            process_account_details(msg);
-            break;
         default:
-            std::cerr << "Unhandled message" << msg.dump() << std::endl;
+            process_message(type, msg, received);
         }
     }
     std::cout << "ws_client exiting" << std::endl;
     co_return;
 }
 
+void ws_client::process_message(payload_type type, const nlohmann::json &msg,
+                                tick::time_type received) {
+    switch (type) {
+    case payload_type::subscribe_response:
+        process_subscribe_response(msg, received);
+        table_.publish();
+        break;
+    case payload_type::price_data:
+        process_price_data(msg, received);
+        table_.publish();
+        break;
+    case payload_type::account_summary:
+        process_account_summary(msg);
+        break;
+    case payload_type::account_details:
+        process_account_details(msg);
+        break;
+    case payload_type::connect_response:
+    case payload_type::reconnect_response:
+    case payload_type::heartbeat:
+    case payload_type::authentication_response:
+        break;
+    default:
+        std::cerr << "Unhandled message" << msg.dump() << std::endl;
+    }
+}
+
+void ws_client::replay(std::string_view frame, tick::time_type received) {
+    auto msg = nlohmann::json::parse(frame);
+    process_message(string_to_payload_type(msg["t"].get<std::string>()), msg,
+                    received);
+}
+
+void ws_client::set_capture(std::unique_ptr<capture_writer> writer) {
+    capture_ = std::move(writer);
+}
+
+void ws_client::set_tick_store(std::unique_ptr<tick_store> store) {
+    store_ = std::move(store);
+}
+
+void ws_client::set_tick_history(std::unique_ptr<tick_history> history) {
+    history_ = std::move(history);
+}
+
 boost::asio::awaitable<void>
 ws_client::process_heartbeat(const nlohmann::json &j) {
     auto now = now_utc();
@@ -227,39 +276,67 @@ ws_client::process_authentication_response(const nlohmann::json &msg) {
                    {"action", "options"}});
 
     // re-establish previous quote subscriptions
-    for (auto quote_id : subscribed_) {
-        co_await send({{"quoteId", quote_id},
-                       {"priceGrouping", "Sampled"},
-                       {"action", "subscribe"}});
+    for (auto [quote_id, g] : subscribed_) {
+        co_await send(subscription_request(quote_id, g, "subscribe"));
     }
     auth_p_.set_value();
+    authenticated_ = true;
+    signal_auth();
     co_return;
 }
 
-void ws_client::process_price_data(const nlohmann::json &msg) {
+void ws_client::process_price_data(const nlohmann::json &msg,
+                                   tick::time_type received) {
     const auto &data = msg["d"];
 
-    for (const auto &key : grouping_map) {
-        if (auto it = data.find(key.first);
-            it != data.end() && it->is_array() && !it->empty()) {
-            auto prices = it->get<std::vector<std::string>>();
-            for (const auto &price : prices) {
-                callbacks_.tick_cb(parse_tick2(price, key.second));
-            }
+    // one array per stream: "sp" sampled, "gp" grouped, ...
+    for (const auto &[key, prices] : data.items()) {
+        auto g = grouping_map.find(key);
+        if (g == grouping_map.end() || !prices.is_array()) {
+            continue;
+        }
+        for (const auto &price : prices) {
+            dispatch_tick(
+                parse_tick2(price.get_ref<const std::string &>(), g->second),
+                received);
         }
     }
 }
 
-void ws_client::process_subscribe_response(const nlohmann::json &msg) {
+void ws_client::process_subscribe_response(const nlohmann::json &msg,
+                                           tick::time_type received) {
     auto d = msg["d"];
     verify(d["HasError"].get<bool>() == false, "HasError is true");
     auto prices = d["Current"].get<std::vector<std::string>>();
     auto g = string_to_price_type(d["PriceGrouping"].get<std::string>());
     for (const auto &p : prices) {
-        callbacks_.tick_cb(parse_tick(p, g));
+        dispatch_tick(parse_tick(p, g), received);
     }
 }
 
+void ws_client::dispatch_tick(tick &&t, tick::time_type received) {
+    t.received = received;
+    t.decoded = std::chrono::system_clock::now();
+    quotes_.update(t);
+    table_.update(t);
+    if (auto &key = order_keys_[t.quote_id]; t.timestamp >= key.timestamp) {
+        key.hash.assign(t.hash);
+        key.timestamp = t.timestamp;
+    }
+    if (history_) {
+        history_->record(t);
+    }
+    if (store_) {
+        store_->append(t);
+    }
+    callbacks_.tick_cb(std::move(t));
+}
+
+const std::string *ws_client::order_key(int quote_id) const {
+    auto it = order_keys_.find(quote_id);
+    return it == order_keys_.end() ? nullptr : &it->second.hash;
+}
+
 void ws_client::process_account_summary(const nlohmann::json &msg) {
     spdlog::info("account summary received: {}", msg.dump());
     if (msg.at("d").at("PlatformID").get<int>() == 0) {
@@ -278,13 +355,53 @@ void ws_client::process_account_details(const nlohmann::json &msg) {
 
 void ws_client::wait_for_auth() { auth_f_.get(); }
 
+boost::asio::awaitable<void> ws_client::authenticated() {
+    while (!authenticated_) {
+        verify(!stopped_, "ws_client: stopped before authenticating");
+        if (!auth_signal_) {
+            auth_signal_.emplace(co_await boost::asio::this_coro::executor,
+                                 boost::asio::steady_timer::time_point::max());
+        }
+        boost::system::error_code ec;
+        co_await auth_signal_->async_wait(
+            boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    }
+}
+
+void ws_client::signal_auth() {
+    if (auth_signal_) {
+        auth_signal_->cancel();
+    }
+}
+
 boost::asio::awaitable<void> ws_client::run(boost::urls::url_view url,
                                             const std::string &login_id,
                                             const std::string &token,
                                             std::atomic<bool> &shutdown) {
-    while (!shutdown.load()) {
-        co_await connect(url);
-        co_await message_loop(login_id, token, shutdown);
+    stopped_ = false;
+    try {
+        while (!shutdown.load()) {
+            co_await connect(url);
+            co_await message_loop(login_id, token, shutdown);
+        }
+    } catch (...) {
+        stopped_ = true;
+        signal_auth();
+        throw;
+    }
+    stopped_ = true;
+    signal_auth();
+}
+
+boost::asio::awaitable<void> ws_client::close() {
+    if (!ws_) {
+        co_return;
+    }
+    try {
+        co_await ws_->close();
+    } catch (const std::exception &e) {
+        // the connection may never have opened, or already be gone
+        spdlog::debug("ws_client::close: {}", e.what());
     }
 }
 
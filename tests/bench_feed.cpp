@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+// End-to-end feed throughput: fake_feed_server -> ws_client -> tick_cb on
+// one machine. Built as td365_bench, not registered with ctest.
+
+#include "fake_feed_server.h"
+#include <td365/net_profile.h>
+#include <td365/types.h>
+#include <td365/ws_client.h>
+
+#include <algorithm>
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/url.hpp>
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <spdlog/spdlog.h>
+#include <thread>
+#include <vector>
+
+namespace net = boost::asio;
+
+namespace {
+struct feed_result {
+    std::uint64_t ticks = 0;
+    std::uint64_t prices_sent = 0;
+    double ticks_per_sec = 0;
+    std::chrono::nanoseconds p50{}, p99{}, max{};
+    // kernel arrival to decoded, i.e. time spent inside the process
+    std::chrono::nanoseconds process_p50{}, process_p99{};
+    td365::wakeup_stats wakeups; // busy_poll only
+};
+
+feed_result run_feed(fake_feed_server::options opts, int quotes,
+                     std::chrono::seconds duration, bool busy_poll = false) {
+    net::io_context server_ioc;
+    net::io_context client_ioc;
+
+    fake_feed_server server(server_ioc, 0, opts);
+    std::atomic<bool> server_shutdown = false;
+    std::atomic<bool> client_shutdown = false;
+    net::co_spawn(server_ioc, server.run(server_shutdown), net::detached);
+    std::thread server_thread([&] { server_ioc.run(); });
+
+    // tick_cb runs on the client thread; latencies are only read after join
+    std::vector<std::chrono::nanoseconds> latencies;
+    std::vector<std::chrono::nanoseconds> process;
+    latencies.reserve(1U << 22U);
+    process.reserve(1U << 22U);
+    std::atomic<bool> measuring = false;
+
+    td365::user_callbacks callbacks;
+    callbacks.tick_cb = [&](td365::tick &&t) {
+        if (measuring.load(std::memory_order_relaxed) &&
+            latencies.size() < latencies.capacity()) {
+            latencies.push_back(t.latency);
+            process.push_back(t.process_latency());
+        }
+    };
+    auto client = std::make_unique<td365::ws_client>(callbacks);
+
+    std::atomic<bool> done = false;
+    net::co_spawn(
+        client_ioc,
+        [&]() -> net::awaitable<void> {
+            try {
+                boost::urls::url url("ws://127.0.0.1:" +
+                                     std::to_string(server.get_port()));
+                co_await client->run(url, "bench", "bench", client_shutdown);
+            } catch (const std::exception &e) {
+                spdlog::debug("bench client: {}", e.what());
+            }
+            done = true;
+        },
+        net::detached);
+    td365::wakeup_recorder wakeups;
+    std::thread client_thread([&] {
+        if (!busy_poll) {
+            client_ioc.run();
+            return;
+        }
+        while (!client_ioc.stopped()) {
+            wakeups.mark();
+            client_ioc.poll();
+        }
+    });
+
+    client->wait_for_auth();
+    for (int i = 0; i < quotes; ++i) {
+        net::co_spawn(client_ioc, client->subscribe(900000 + i),
+                      net::use_future)
+            .get();
+    }
+
+    auto sent_before = server.prices_sent();
+    auto start = std::chrono::steady_clock::now();
+    measuring = true;
+    std::this_thread::sleep_for(duration);
+    measuring = false;
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    auto sent = server.prices_sent() - sent_before;
+
+    client_shutdown = true;
+    server_shutdown = true;
+    while (!done) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    client_ioc.stop();
+    server_ioc.stop();
+    client_thread.join();
+    server_thread.join();
+
+    feed_result r;
+    r.wakeups = wakeups.stats();
+    r.ticks = latencies.size();
+    r.prices_sent = sent;
+    r.ticks_per_sec =
+        static_cast<double>(r.ticks) /
+        std::chrono::duration<double>(elapsed).count();
+    if (!latencies.empty()) {
+        std::ranges::sort(latencies);
+        r.p50 = latencies[latencies.size() / 2];
+        r.p99 = latencies[latencies.size() * 99 / 100];
+        r.max = latencies.back();
+        std::ranges::sort(process);
+        r.process_p50 = process[process.size() / 2];
+        r.process_p99 = process[process.size() * 99 / 100];
+    }
+    return r;
+}
+
+void report(std::string_view name, const feed_result &r) {
+    spdlog::info("{}: {} ticks ({} sent), {:.0f} ticks/s, latency p50={}us "
+                 "p99={}us max={}us, in-process p50={}us p99={}us",
+                 name, r.ticks, r.prices_sent, r.ticks_per_sec,
+                 r.p50.count() / 1000, r.p99.count() / 1000,
+                 r.max.count() / 1000, r.process_p50.count() / 1000,
+                 r.process_p99.count() / 1000);
+}
+} // namespace
+
+TEST_CASE("feed: maximum sustainable tick rate", "[benchmark][feed]") {
+    for (int burst : {1, 10, 50}) {
+        auto r = run_feed({.rate = 0, .burst = burst}, 100,
+                          std::chrono::seconds(3));
+        report(std::format("unpaced burst={}", burst), r);
+        REQUIRE(r.ticks > 0);
+    }
+}
+
+TEST_CASE("feed: latency under fixed load", "[benchmark][feed]") {
+    for (int rate : {1000, 10000, 50000}) {
+        auto r = run_feed({.rate = rate, .burst = 1}, 100,
+                          std::chrono::seconds(3));
+        report(std::format("rate={}/s", rate), r);
+        REQUIRE(r.ticks > 0);
+    }
+}
+
+TEST_CASE("feed: busy-poll wake-up-to-read latency", "[benchmark][feed]") {
+    auto r = run_feed({.rate = 10000, .burst = 1}, 100,
+                      std::chrono::seconds(3), true);
+    report("busy-poll rate=10000/s", r);
+    const auto &w = r.wakeups;
+    spdlog::info("wake-up-to-read: {} samples, min={}ns mean={}ns max={}ns",
+                 w.samples, w.min.count(), w.mean.count(), w.max.count());
+    REQUIRE(r.ticks > 0);
+    REQUIRE(w.samples > 0);
+}
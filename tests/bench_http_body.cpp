@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+// gzip response decoding: get_http_body's inflate into a new string
+// against a reused buffer, on catalogue-sized bodies. Built into
+// td365_bench, not registered with ctest.
+
+#include <td365/utils.h>
+
+#include <catch2/catch_all.hpp>
+#include <format>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <zlib.h>
+
+namespace {
+// roughly what GetMarketQuote returns for a large group
+std::string catalogue(int markets) {
+    nlohmann::json d = nlohmann::json::array();
+    for (int i = 0; i < markets; ++i) {
+        d.push_back({{"MarketID", 1000 + i},
+                     {"QuoteID", 50000 + i},
+                     {"MarketName", std::format("Market number {}", i)},
+                     {"Bid", 1234.5 + i},
+                     {"Ask", 1235.5 + i},
+                     {"DailyChange", -1.25},
+                     {"High", 1300.0},
+                     {"Low", 1200.0},
+                     {"Tradable", true},
+                     {"CallOnly", false},
+                     {"DecimalPlaces", 1},
+                     {"MinStake", "0.1"},
+                     {"Hash", "O+E4W55s4o+2dEv3T2kaaz+lkLwePRX97aJOsVcIe6c="}});
+    }
+    return nlohmann::json{{"d", d}}.dump();
+}
+
+std::string gzip(std::string_view in) {
+    z_stream zs{};
+    deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                 Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&zs, static_cast<uLong>(in.size())), '\0');
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+    zs.avail_in = static_cast<uInt>(in.size());
+    zs.next_out = reinterpret_cast<Bytef *>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+    deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+
+td365::http_response response(std::string body) {
+    td365::http_response res{boost::beast::http::status::ok, 11};
+    res.set(boost::beast::http::field::content_encoding, "gzip");
+    res.body() = std::move(body);
+    return res;
+}
+} // namespace
+
+TEST_CASE("http body: gzip decode", "[benchmark][http]") {
+    for (int markets : {500, 5000}) {
+        const auto plain = catalogue(markets);
+        const auto res = response(gzip(plain));
+        std::string buffer;
+
+        REQUIRE(td365::get_http_body(res, buffer) == plain);
+        REQUIRE(td365::get_http_body(res) == plain);
+
+        const auto name = std::format("{} markets, {} KiB", markets,
+                                      plain.size() / 1024);
+        BENCHMARK("inflate, new string: " + name) {
+            return td365::get_http_body(res);
+        };
+        BENCHMARK("inflate, reused buffer: " + name) {
+            return td365::get_http_body(res, buffer).size();
+        };
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+// Order request body construction: the nlohmann::json object rest_api used
+// to build per order against a prepared order_template. Built into
+// td365_bench, not registered with ctest.
+
+#include <td365/order_template.h>
+
+#include <catch2/catch_all.hpp>
+#include <nlohmann/json.hpp>
+#include <string>
+
+namespace {
+std::string json_body(const td365::trade_request &request) {
+    nlohmann::json body = {
+        {"marketID", request.market_id},
+        {"quoteID", request.quote_id},
+        {"price", request.price},
+        {"stake", std::to_string(request.stake)},
+        {"tradeType", 1},
+        {"tradeMode", request.dir == td365::trade_request::direction::sell},
+        {"hasClosingOrder", true},
+        {"isGuaranteed", false},
+        {"orderModeID", 3},
+        {"orderTypeID", 2},
+        {"orderPriceModeID", 2},
+        {"limitOrderPrice", std::to_string(request.limit)},
+        {"stopOrderPrice", std::to_string(request.stop)},
+        {"trailingPoint", 0},
+        {"closePositionID", 0},
+        {"isKaazingFeed", true},
+        {"userAgent", "Firefox (139.0)"},
+        {"key", request.key}};
+    return body.dump();
+}
+} // namespace
+
+TEST_CASE("order body: construction", "[benchmark][order]") {
+    td365::trade_request request{
+        .dir = td365::trade_request::direction::buy,
+        .market_id = 870964,
+        .quote_id = 455503,
+        .price = 104850.5,
+        .stake = 0.5,
+        .stop = 104800.0,
+        .limit = 104950.0,
+        .key = "O+E4W55s4o+2dEv3T2kaaz+lkLwePRX97aJOsVcIe6c="};
+    td365::order_template tmpl(request.market_id, request.quote_id);
+    REQUIRE(tmpl.render(request) == json_body(request));
+
+    BENCHMARK("nlohmann::json") {
+        request.price += 0.5;
+        return json_body(request);
+    };
+    BENCHMARK("order_template") {
+        request.price += 0.5;
+        return tmpl.render(request).size();
+    };
+    // as sent: rendered into the string http_client takes as the body
+    BENCHMARK("order_template, into a request body") {
+        request.price += 0.5;
+        auto body = std::string();
+        tmpl.render(request, body);
+        return body;
+    };
+}
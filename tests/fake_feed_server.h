@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <chrono>
+#include <deque>
+#include <format>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <vector>
+
+// Local stand-in for the price feed. It speaks enough of the protocol for
+// ws_client to connect, authenticate and subscribe, then streams synthetic
+// "p" frames for every subscribed quote.
+class fake_feed_server {
+  public:
+    struct options {
+        // price frames per second per connection, 0 = as fast as the socket
+        // drains
+        int rate = 1000;
+        // prices per frame, cycling over the subscribed quotes
+        int burst = 1;
+        // don't stream at all, only answer the handshake
+        bool stream = true;
+        // close every connection `disconnect_delay` after connectResponse
+        bool disconnect_after_connect = false;
+        std::chrono::milliseconds disconnect_delay{1000};
+    };
+
+    fake_feed_server(boost::asio::io_context &ioc, unsigned short port)
+        : fake_feed_server(ioc, port, options{}) {}
+
+    fake_feed_server(boost::asio::io_context &ioc, unsigned short port,
+                     options opts)
+        : ioc_(ioc),
+          acceptor_(ioc, boost::asio::ip::tcp::endpoint(
+                             boost::asio::ip::tcp::v4(), port)),
+          opts_(opts) {
+        // Get the actual port number assigned by the system
+        port_ = acceptor_.local_endpoint().port();
+    }
+
+    boost::asio::awaitable<void> run(std::atomic<bool> &shutdown) {
+        while (!shutdown.load()) {
+            try {
+                auto socket = co_await acceptor_.async_accept(
+                    boost::asio::use_awaitable);
+                auto s = std::make_shared<session>(std::move(socket));
+                boost::asio::co_spawn(ioc_, handle_session(s, shutdown),
+                                      boost::asio::detached);
+            } catch (const std::exception &e) {
+                if (!shutdown.load()) {
+                    spdlog::debug("Server accept error: {}", e.what());
+                }
+                break;
+            }
+        }
+    }
+
+    void set_disconnect_after_connect(bool disconnect) {
+        opts_.disconnect_after_connect = disconnect;
+    }
+
+    void set_disconnect_delay(std::chrono::milliseconds delay) {
+        opts_.disconnect_delay = delay;
+    }
+
+    int get_connection_count() const { return connection_count_.load(); }
+    std::uint64_t frames_sent() const { return frames_sent_.load(); }
+    std::uint64_t prices_sent() const { return prices_sent_.load(); }
+
+    unsigned short get_port() const { return port_; }
+
+    // Windows ticks (100ns since 0001-01-01), as used in price strings
+    static std::int64_t windows_ticks_now() {
+        constexpr std::int64_t unix_epoch = 621355968000000000LL;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+        return unix_epoch + ns / 100;
+    }
+
+  private:
+    using websocket_type =
+        boost::beast::websocket::stream<boost::asio::ip::tcp::socket>;
+
+    struct subscription {
+        int quote_id;
+        std::string key; // "sp", "gp", ...
+    };
+
+    struct session {
+        explicit session(boost::asio::ip::tcp::socket socket)
+            : ws(std::move(socket)), wake(ws.get_executor()) {
+            wake.expires_at(std::chrono::steady_clock::time_point::max());
+        }
+
+        websocket_type ws;
+        boost::asio::steady_timer wake;
+        std::deque<std::string> outbox;
+        std::vector<subscription> subscriptions;
+        bool open = true;
+        int seq = 0;
+    };
+
+    static std::string grouping_key(std::string_view grouping) {
+        if (grouping == "Grouped")
+            return "gp";
+        if (grouping == "Delayed")
+            return "dp";
+        if (grouping == "Candle1Minute")
+            return "c1m";
+        return "sp";
+    }
+
+    static std::string price(int quote_id, int seq) {
+        double bid = 1000.0 + quote_id % 1000 + (seq % 100) * 0.25;
+        double ask = bid + 1.0;
+        return std::format("{},{:.2f},{:.2f},-1.50,{},1,{:.2f},{:.2f},"
+                           "O+E4W55s4o+2dEv3T2kaaz+lkLwePRX97aJOsVcIe6c=,0,"
+                           "{:.2f},{},{}",
+                           quote_id, bid, ask, (seq & 1) ? "u" : "d",
+                           bid + 50.0, bid - 50.0, (bid + ask) / 2,
+                           windows_ticks_now(), seq);
+    }
+
+    static void post(session &s, std::string msg) {
+        s.outbox.push_back(std::move(msg));
+        s.wake.cancel();
+    }
+
+    boost::asio::awaitable<void> writer(std::shared_ptr<session> s) {
+        try {
+            while (s->open) {
+                if (s->outbox.empty()) {
+                    boost::system::error_code ec;
+                    co_await s->wake.async_wait(boost::asio::redirect_error(
+                        boost::asio::use_awaitable, ec));
+                    s->wake.expires_at(
+                        std::chrono::steady_clock::time_point::max());
+                    continue;
+                }
+                auto msg = std::move(s->outbox.front());
+                s->outbox.pop_front();
+                co_await s->ws.async_write(boost::asio::buffer(msg),
+                                           boost::asio::use_awaitable);
+            }
+        } catch (const std::exception &e) {
+            spdlog::debug("fake_feed_server writer: {}", e.what());
+        }
+        s->open = false;
+    }
+
+    boost::asio::awaitable<void> streamer(std::shared_ptr<session> s) {
+        using clock = std::chrono::steady_clock;
+        auto period = opts_.rate > 0
+                          ? std::chrono::nanoseconds(1000000000 / opts_.rate)
+                          : std::chrono::nanoseconds(0);
+        boost::asio::steady_timer timer(s->ws.get_executor());
+        auto next = clock::now();
+        size_t cursor = 0;
+
+        while (s->open) {
+            // pace at the configured rate; when unlimited, only keep a few
+            // frames queued so the socket stays the bottleneck
+            if (opts_.rate > 0) {
+                next += period;
+                timer.expires_at(next);
+                co_await timer.async_wait(boost::asio::use_awaitable);
+            } else if (s->outbox.size() >= 16 || s->subscriptions.empty()) {
+                timer.expires_after(std::chrono::microseconds(50));
+                co_await timer.async_wait(boost::asio::use_awaitable);
+                continue;
+            }
+            if (s->subscriptions.empty()) {
+                continue;
+            }
+
+            // group this burst by stream key
+            std::string frame = R"({"t":"p","d":{)";
+            const auto &key = s->subscriptions[cursor %
+                                               s->subscriptions.size()]
+                                  .key;
+            frame += std::format(R"("{}":[)", key);
+            int n = 0;
+            for (int i = 0; i < opts_.burst; ++i) {
+                const auto &sub =
+                    s->subscriptions[cursor++ % s->subscriptions.size()];
+                if (sub.key != key) {
+                    continue;
+                }
+                if (n++ > 0) {
+                    frame += ',';
+                }
+                frame += '"';
+                frame += price(sub.quote_id, s->seq++);
+                frame += '"';
+            }
+            frame += "]}}";
+
+            post(*s, std::move(frame));
+            frames_sent_++;
+            prices_sent_ += static_cast<std::uint64_t>(n);
+        }
+    }
+
+    void handle_request(session &s, const nlohmann::json &req) {
+        auto action = req.value("action", "");
+        if (action == "authentication") {
+            post(s, nlohmann::json{{"t", "authenticationResponse"},
+                                   {"cid", std::format("cid-{}",
+                                                       connection_count_.load())},
+                                   {"d", {{"Result", true}}}}
+                        .dump());
+        } else if (action == "subscribe") {
+            int quote_id = req.at("quoteId").get<int>();
+            auto grouping = req.value("priceGrouping", "Sampled");
+            s.subscriptions.push_back({quote_id, grouping_key(grouping)});
+            post(s, nlohmann::json{{"t", "subscribeResponse"},
+                                   {"d",
+                                    {{"HasError", false},
+                                     {"PriceGrouping", grouping},
+                                     {"Current", {price(quote_id, s.seq++)}}}}}
+                        .dump());
+        } else if (action == "unsubscribe") {
+            int quote_id = req.at("quoteId").get<int>();
+            auto key = grouping_key(req.value("priceGrouping", "Sampled"));
+            std::erase_if(s.subscriptions, [&](const auto &sub) {
+                return sub.quote_id == quote_id && sub.key == key;
+            });
+        }
+        // heartbeat, options and reconnect need no answer
+    }
+
+    boost::asio::awaitable<void>
+    handle_session(std::shared_ptr<session> s, std::atomic<bool> &shutdown) {
+        try {
+            // Accept the WebSocket handshake
+            co_await s->ws.async_accept(boost::asio::use_awaitable);
+            s->ws.text(true);
+
+            connection_count_++;
+
+            boost::asio::co_spawn(ioc_, writer(s), boost::asio::detached);
+            post(*s, R"({"t":"connectResponse"})");
+
+            if (opts_.disconnect_after_connect) {
+                // Wait for specified delay then disconnect
+                boost::asio::steady_timer timer(ioc_);
+                timer.expires_after(opts_.disconnect_delay);
+                co_await timer.async_wait(boost::asio::use_awaitable);
+
+                s->open = false;
+                s->wake.cancel();
+                co_await s->ws.async_close(
+                    boost::beast::websocket::close_code::normal,
+                    boost::asio::use_awaitable);
+                co_return;
+            }
+
+            if (opts_.stream) {
+                boost::asio::co_spawn(ioc_, streamer(s),
+                                      boost::asio::detached);
+            }
+
+            while (!shutdown.load() && s->open) {
+                boost::beast::flat_buffer buffer;
+                co_await s->ws.async_read(buffer, boost::asio::use_awaitable);
+                handle_request(
+                    *s, nlohmann::json::parse(
+                            boost::beast::buffers_to_string(buffer.data())));
+            }
+        } catch (const std::exception &e) {
+            spdlog::debug("WebSocket connection error: {}", e.what());
+        }
+        s->open = false;
+        s->wake.cancel();
+    }
+
+    boost::asio::io_context &ioc_;
+    boost::asio::ip::tcp::acceptor acceptor_;
+    unsigned short port_;
+    options opts_;
+    std::atomic<int> connection_count_ = 0;
+    std::atomic<std::uint64_t> frames_sent_ = 0;
+    std::atomic<std::uint64_t> prices_sent_ = 0;
+};
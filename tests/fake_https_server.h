@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <set>
+#include <spdlog/spdlog.h>
+#include <string>
+
+// Local stand-in for the REST hosts: TLS with a throwaway self-signed
+// certificate, HTTP/1.1 keep-alive, and every request answered by a
+// handler. http_client reaches it through the PROXY override.
+class fake_https_server {
+  public:
+    using request = boost::beast::http::request<boost::beast::http::string_body>;
+    using response =
+        boost::beast::http::response<boost::beast::http::string_body>;
+    using handler = std::function<response(const request &)>;
+
+    struct options {
+        // hold each response back this long, so requests overlap
+        std::chrono::milliseconds delay{0};
+    };
+
+    fake_https_server(boost::asio::io_context &ioc, handler h)
+        : fake_https_server(ioc, std::move(h), options{}) {}
+
+    fake_https_server(boost::asio::io_context &ioc, handler h, options opts)
+        : ioc_(ioc),
+          acceptor_(ioc, boost::asio::ip::tcp::endpoint(
+                             boost::asio::ip::make_address("127.0.0.1"), 0)),
+          ctx_(boost::asio::ssl::context::tls_server), handler_(std::move(h)),
+          opts_(opts) {
+        use_self_signed_certificate();
+    }
+
+    boost::asio::awaitable<void> run() {
+        for (;;) {
+            boost::system::error_code ec;
+            auto socket = co_await acceptor_.async_accept(
+                boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            if (ec) {
+                break;
+            }
+            ++accepted_;
+            boost::asio::co_spawn(ioc_, session(std::move(socket)),
+                                  boost::asio::detached);
+        }
+    }
+
+    void stop() {
+        boost::system::error_code ignored;
+        acceptor_.close(ignored);
+        close_idle();
+    }
+
+    // Close every connection waiting for its next request, the way a
+    // server's keep-alive timeout does.
+    void close_idle() {
+        for (auto *s : idle_) {
+            boost::system::error_code ignored;
+            s->lowest_layer().shutdown(boost::asio::ip::tcp::socket::shutdown_both,
+                                       ignored);
+        }
+    }
+
+    std::string url() const {
+        return "http://127.0.0.1:" +
+               std::to_string(acceptor_.local_endpoint().port());
+    }
+
+    unsigned short port() const { return acceptor_.local_endpoint().port(); }
+
+    int accepted() const { return accepted_; }
+    int requests() const { return requests_; }
+    int max_in_flight() const { return max_in_flight_; }
+    // start measuring max_in_flight afresh
+    void reset_max_in_flight() { max_in_flight_ = in_flight_; }
+
+  private:
+    using stream_type =
+        boost::asio::ssl::stream<boost::asio::ip::tcp::socket>;
+
+    void use_self_signed_certificate() {
+        EVP_PKEY *key = EVP_EC_gen("P-256");
+        X509 *cert = X509_new();
+        X509_set_version(cert, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME *name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(
+            name, "CN", MBSTRING_ASC,
+            reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        X509_sign(cert, key, EVP_sha256());
+        SSL_CTX_use_certificate(ctx_.native_handle(), cert);
+        SSL_CTX_use_PrivateKey(ctx_.native_handle(), key);
+        X509_free(cert);
+        EVP_PKEY_free(key);
+    }
+
+    boost::asio::awaitable<void> session(boost::asio::ip::tcp::socket socket) {
+        namespace http = boost::beast::http;
+        auto stream = std::make_unique<stream_type>(std::move(socket), ctx_);
+        boost::system::error_code ec;
+        co_await stream->async_handshake(
+            boost::asio::ssl::stream_base::server,
+            boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+
+        boost::beast::flat_buffer buffer;
+        while (!ec) {
+            request req;
+            idle_.insert(stream.get());
+            co_await http::async_read(
+                *stream, buffer, req,
+                boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            idle_.erase(stream.get());
+            if (ec) {
+                break;
+            }
+            ++requests_;
+
+            max_in_flight_ = std::max(max_in_flight_, ++in_flight_);
+            if (opts_.delay.count() > 0) {
+                boost::asio::steady_timer t(ioc_, opts_.delay);
+                co_await t.async_wait(boost::asio::redirect_error(
+                    boost::asio::use_awaitable, ec));
+            }
+            --in_flight_;
+
+            auto res = handler_(req);
+            res.version(req.version());
+            res.keep_alive(req.keep_alive());
+            res.prepare_payload();
+            co_await http::async_write(
+                *stream, res,
+                boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        }
+        spdlog::debug("fake_https_server session: {}", ec.message());
+    }
+
+    boost::asio::io_context &ioc_;
+    boost::asio::ip::tcp::acceptor acceptor_;
+    boost::asio::ssl::context ctx_;
+    handler handler_;
+    options opts_;
+
+    std::set<stream_type *> idle_;
+    int accepted_ = 0;
+    int requests_ = 0;
+    int in_flight_ = 0;
+    int max_in_flight_ = 0;
+};
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include "fake_https_server.h"
+
+#include <map>
+#include <nlohmann/json.hpp>
+#include <string>
+
+// A GetMarketDetails response with every field zero, false or empty.
+inline nlohmann::json details_json() {
+    nlohmann::json details = {
+        {"MarketName", ""}, {"TradeStartTime", ""}, {"Currency", ""}};
+    for (const auto *k :
+         {"IsInPortfolio", "Tradable", "TradeOnWeb", "CallOnly", "ForceOpen",
+          "MarginType", "Subscription"}) {
+        details[k] = false;
+    }
+    for (const auto *k :
+         {"MarketID", "QuoteID", "AtQuoteAtMarket", "ExchangeID",
+          "PrcGenFractionalPrice", "PrcGenDecimalPlaces", "High", "Low",
+          "DailyChange", "Bid", "Ask", "BetPer", "IsGSLPercent", "GSLDis",
+          "MinCloseOrderDisTicks", "MinOpenOrderDisTicks", "DisplayBetPer",
+          "AllowGtdsStops", "Margin", "GSLCharge", "IsGSLChargePercent",
+          "Spread", "TradeRateType", "OpenTradeRate", "CloseTradeRate",
+          "MinOpenTradeRate", "MinCloseTradeRate", "PriceDecimal",
+          "SuperGroupID"}) {
+        details[k] = 0;
+    }
+    nlohmann::json web_info;
+    for (const auto *k :
+         {"IsDealAlwayHedge", "IsDealAlwayGuarantee", "IsOneClickTrade",
+          "IsOrderAlwayHedge", "IsOrderAlwayGuarantee"}) {
+        web_info[k] = false;
+    }
+    for (const auto *k :
+         {"CFDDefaultStake", "StopTypeID", "TradeOrderTypeID",
+          "DealDefaultStake", "OrderDefaultStake", "WebMinStake",
+          "WebMaxStake"}) {
+        web_info[k] = 0;
+    }
+    return {{"d", {{"marketDetails", details}, {"webInfo", web_info}}}};
+}
+
+// The web client page and the order endpoints, counting requests per path.
+// Serve it with fake_https_server.
+struct trading_host {
+    std::map<std::string, int> hits;
+    bool fail_trades = false;
+
+    fake_https_server::response
+    operator()(const fake_https_server::request &req) {
+        namespace http = boost::beast::http;
+        const auto target = std::string(req.target());
+        const auto path = target.substr(0, target.find('?'));
+        ++hits[path];
+
+        fake_https_server::response res{http::status::ok, req.version()};
+        if (path == "/Advanced.aspx") {
+            res.set(http::field::set_cookie, "OTS=token; Path=/");
+            res.body() = R"(<input id="hfLoginID" value="1234" />)"
+                         R"(<input id="hfAccountID" value="5678" />)";
+        } else if (path == "/UTSAPI.asmx/GetMarketSuperGroup") {
+            res.body() = R"({"d":[{"ID":1,"Name":"Indices","IsSuperGroup":true,)"
+                         R"("IsWhiteLabelPopularMarket":false,)"
+                         R"("HasSubscription":false}]})";
+        } else if (path == "/UTSAPI.asmx/GetMarketDetails") {
+            res.body() = details_json().dump();
+        } else if (path == "/UTSAPI.asmx/RequestTrade" && fail_trades) {
+            res.result(http::status::internal_server_error);
+        } else {
+            res.body() = R"({"d":{}})";
+        }
+        return res;
+    }
+
+    int details() const { return count("/UTSAPI.asmx/GetMarketDetails"); }
+    int simulates() const { return count("/UTSAPI.asmx/RequestTradeSimulate"); }
+    int trades() const { return count("/UTSAPI.asmx/RequestTrade"); }
+
+    int count(const std::string &path) const {
+        auto it = hits.find(path);
+        return it == hits.end() ? 0 : it->second;
+    }
+};
+
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include "fake_feed_server.h"
+#include "fake_https_server.h"
+#include "fake_trading_host.h"
+#include <td365/td365.h>
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <exception>
+#include <format>
+#include <thread>
+
+// The REST host and the feed, served from a thread of their own.
+struct fake_venue {
+    boost::asio::io_context ioc;
+    trading_host host;
+    fake_https_server rest;
+    fake_feed_server feed{ioc, 0, {.stream = false}};
+    std::atomic<bool> feed_shutdown = false;
+    std::thread thread;
+
+    explicit fake_venue(fake_https_server::options opts = {})
+        : rest(ioc, std::ref(host), opts) {
+        boost::asio::co_spawn(ioc, rest.run(), boost::asio::detached);
+        boost::asio::co_spawn(ioc, feed.run(feed_shutdown),
+                              boost::asio::detached);
+        thread = std::thread([this] { ioc.run(); });
+    }
+
+    ~fake_venue() {
+        feed_shutdown = true;
+        ioc.stop();
+        thread.join();
+    }
+
+    td365::web_detail detail() const {
+        td365::web_detail d{};
+        d.platform_url = boost::urls::url(std::format(
+            "https://localhost:{}/Advanced.aspx?ots=OTS", rest.port()));
+        d.sock_host = boost::urls::url(
+            std::format("ws://127.0.0.1:{}", feed.get_port()));
+        return d;
+    }
+};
+
+// Connects `client` by running `ioc` until the connect completes.
+inline bool connect_to(td365::td365 &client, const fake_venue &venue,
+                       boost::asio::io_context &ioc) {
+    bool connected = false;
+    client.async_connect(venue.detail(), [&](std::exception_ptr e) {
+        connected = !e;
+        ioc.stop();
+    });
+    ioc.run_for(std::chrono::seconds(10));
+    ioc.restart();
+    return connected;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include "tick_fixture.h"
+#include <td365/arrow_ipc.h>
+
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+std::string export_path(std::string_view name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+std::vector<char> slurp(const std::string &path) {
+    std::ifstream f(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(f), {}};
+}
+
+std::uint32_t u32_at(const std::vector<char> &b, std::size_t at) {
+    std::uint32_t v;
+    std::memcpy(&v, &b[at], sizeof(v));
+    return v;
+}
+
+// the i-th tick of quote 42, a second apart
+td365::tick nth_tick(int i) {
+    auto t = make_tick(
+        42, 100 + i, 101 + i,
+        td365::tick::time_type(std::chrono::seconds(1741078800 + i)));
+    t.hash = "h" + std::to_string(i);
+    return t;
+}
+} // namespace
+
+TEST_CASE("arrow file export is framed for memory mapping", "[arrow]") {
+    const auto path = export_path("td365_ticks.arrow");
+    {
+        td365::arrow_tick_writer writer(path, td365::arrow_format::file, 2);
+        for (int i = 0; i < 5; ++i) {
+            writer.write(nth_tick(i));
+        }
+    }
+
+    const auto b = slurp(path);
+    REQUIRE(b.size() > 64);
+    REQUIRE(std::memcmp(b.data(), "ARROW1\0\0", 8) == 0);
+    REQUIRE(std::memcmp(b.data() + b.size() - 6, "ARROW1", 6) == 0);
+
+    // schema message follows the magic, 8-byte aligned
+    REQUIRE(u32_at(b, 8) == 0xFFFFFFFF);
+    REQUIRE(u32_at(b, 12) % 8 == 0);
+
+    // footer length, then the end-of-stream marker just before the footer
+    const auto footer = u32_at(b, b.size() - 10);
+    const auto eos = b.size() - 10 - footer - 8;
+    REQUIRE(footer < b.size());
+    REQUIRE(u32_at(b, eos) == 0xFFFFFFFF);
+    REQUIRE(u32_at(b, eos + 4) == 0);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("arrow stream export ends with end-of-stream", "[arrow]") {
+    const auto path = export_path("td365_candles.arrows");
+    const std::vector<td365::candle> candles = {
+        {std::chrono::system_clock::time_point(std::chrono::minutes(1)), 1, 2,
+         0.5, 1.5, 10},
+        {std::chrono::system_clock::time_point(std::chrono::minutes(2)), 1.5,
+         3, 1, 2, 4}};
+    {
+        td365::arrow_candle_writer writer(path, td365::arrow_format::stream);
+        writer.write(candles);
+        writer.flush();
+        writer.write(candles.front());
+    }
+
+    const auto b = slurp(path);
+    REQUIRE(u32_at(b, 0) == 0xFFFFFFFF);
+    REQUIRE(u32_at(b, b.size() - 8) == 0xFFFFFFFF);
+    REQUIRE(u32_at(b, b.size() - 4) == 0);
+
+    // schema, two batches, end of stream: walk the messages
+    std::size_t pos = 0, messages = 0;
+    for (;;) {
+        REQUIRE(u32_at(b, pos) == 0xFFFFFFFF);
+        const auto meta = u32_at(b, pos + 4);
+        if (meta == 0) {
+            break;
+        }
+        // bodyLength is the int64 after the vtable offset in Message
+        std::int64_t body = 0;
+        const auto root = pos + 8 + u32_at(b, pos + 8);
+        std::int32_t vt;
+        std::memcpy(&vt, &b[root], sizeof(vt));
+        std::uint16_t body_field;
+        std::memcpy(&body_field, &b[root - vt + 4 + 2 * 3], sizeof(body_field));
+        if (body_field != 0) {
+            std::memcpy(&body, &b[root + body_field], sizeof(body));
+        }
+        pos += 8 + meta + static_cast<std::size_t>(body);
+        ++messages;
+    }
+    REQUIRE(messages == 3);
+    REQUIRE(pos + 8 == b.size());
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("arrow tick export has the same columns for stored ticks",
+          "[arrow]") {
+    const auto path = export_path("td365_stored_ticks.arrow");
+    {
+        td365::arrow_tick_writer writer(path, td365::arrow_format::file);
+        auto live = nth_tick(0);
+        live.received = live.timestamp + std::chrono::milliseconds(3);
+        writer.write(live);
+
+        td365::stored_tick stored{};
+        stored.quote_id = live.quote_id;
+        stored.timestamp = live.timestamp;
+        stored.received = live.received;
+        stored.bid = live.bid;
+        stored.ask = live.ask;
+        writer.write(stored);
+    }
+
+    const auto b = slurp(path);
+    const std::string_view bytes(b.data(), b.size());
+    REQUIRE(bytes.find("network_latency") != std::string_view::npos);
+
+    // the batch's field nodes, {length, null_count} per column: only the
+    // stored row's latency and decoded are null, not a stand-in value
+    constexpr std::size_t columns = 18, latency = 14, decoded = 17;
+    std::vector<std::int64_t> nodes;
+    for (std::size_t c = 0; c < columns; ++c) {
+        nodes.push_back(2);
+        nodes.push_back(c == latency || c == decoded ? 1 : 0);
+    }
+    const std::string_view want(reinterpret_cast<const char *>(nodes.data()),
+                                nodes.size() * sizeof(std::int64_t));
+    REQUIRE(bytes.find(want) != std::string_view::npos);
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include "fake_https_server.h"
+#include <td365/candle_cache.h>
+#include <td365/rest_api.h>
+#include <td365/types.h>
+
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <map>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+using namespace std::chrono_literals;
+
+namespace {
+// The chart host: `/data/minute/<market>/mid?l=<n>` answers with the last
+// `n` minute candles up to the current one, newest first, each closing at
+// its minute since the epoch. Markets in `failing` get a 500.
+struct chart_host {
+    std::vector<std::string> targets;
+    std::map<int, int> hits;
+    std::vector<int> failing;
+
+    fake_https_server::response
+    operator()(const fake_https_server::request &req) {
+        const auto target = std::string(req.target());
+        targets.push_back(target);
+
+        int market = 0;
+        int n = 0;
+        std::sscanf(target.c_str(), "/data/minute/%d/mid?l=%d", &market, &n);
+        ++hits[market];
+
+        fake_https_server::response res{http::status::ok, req.version()};
+        if (std::ranges::find(failing, market) != failing.end()) {
+            res.result(http::status::internal_server_error);
+            return res;
+        }
+        const auto now = std::chrono::floor<std::chrono::minutes>(
+            std::chrono::system_clock::now());
+        auto data = nlohmann::json::array();
+        for (int i = 0; i < n; ++i) {
+            const auto t = now - std::chrono::minutes(i);
+            const auto m = t.time_since_epoch().count();
+            data.push_back(std::format("{:%FT%T}+00:00,{},{},{},{},1", t, m,
+                                       m + 1, m - 1, m));
+        }
+        res.body() = nlohmann::json{{"data", data}}.dump();
+        return res;
+    }
+
+    // the `l=` of each request for `market`, in order
+    std::vector<int> lengths(int market) const {
+        std::vector<int> rv;
+        for (const auto &t : targets) {
+            int m = 0;
+            int n = 0;
+            if (std::sscanf(t.c_str(), "/data/minute/%d/mid?l=%d", &m, &n) ==
+                    2 &&
+                m == market) {
+                rv.push_back(n);
+            }
+        }
+        return rv;
+    }
+};
+
+// Runs `test` with a rest_api whose chart requests go to `server`.
+void with_chart_host(
+    fake_https_server &server, net::io_context &ioc,
+    std::function<net::awaitable<void>(td365::rest_api &)> test) {
+    ::setenv("PROXY", server.url().c_str(), 1);
+    net::co_spawn(ioc, server.run(), net::detached);
+    net::co_spawn(
+        ioc,
+        [&]() -> net::awaitable<void> {
+            auto api = std::make_shared<td365::rest_api>();
+            co_await test(*api);
+            server.stop();
+        },
+        [](std::exception_ptr e) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        });
+    ioc.run();
+    ::unsetenv("PROXY");
+}
+
+std::vector<td365::backfill_request> markets(int from, int to, size_t sz) {
+    std::vector<td365::backfill_request> rv;
+    for (int m = from; m <= to; ++m) {
+        rv.push_back({.market_id = m, .quote_id = m * 10, .sz = sz});
+    }
+    return rv;
+}
+
+std::string cache_dir(std::string_view name) {
+    auto dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    return dir.string();
+}
+
+// oldest first, one minute apart
+bool consecutive(const std::vector<td365::candle> &candles) {
+    for (size_t i = 1; i < candles.size(); ++i) {
+        if (candles[i].timestamp - candles[i - 1].timestamp != 1min) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs `n` single-market backfills at once and waits for all of them.
+net::awaitable<void> concurrent_backfills(td365::rest_api &api, int n) {
+    auto ex = co_await net::this_coro::executor;
+    auto done = net::steady_timer(ex, net::steady_timer::time_point::max());
+    int running = n;
+    for (int i = 0; i < n; ++i) {
+        net::co_spawn(ex,
+                      api.backfill(100 + i, 0, 5, td365::chart_duration::m1),
+                      [&](std::exception_ptr, std::vector<td365::candle>) {
+                          if (--running == 0) {
+                              done.cancel();
+                          }
+                      });
+    }
+    boost::system::error_code ec;
+    co_await done.async_wait(net::redirect_error(net::use_awaitable, ec));
+}
+} // namespace
+
+TEST_CASE("batch backfill runs at most `concurrency` requests at once",
+          "[backfill]") {
+    net::io_context ioc;
+    chart_host host;
+    fake_https_server server(ioc, std::ref(host), {.delay = 100ms});
+    auto test = [&](td365::rest_api &api) -> net::awaitable<void> {
+        std::map<int, int> results;
+        co_await api.backfill(markets(1, 12, 5), 3,
+                              [&](td365::backfill_result &&r) {
+                                  CHECK_FALSE(r.error);
+                                  CHECK(r.candles.size() == 5);
+                                  ++results[r.request.market_id];
+                              });
+        CHECK(server.max_in_flight() == 3);
+        CHECK(server.accepted() == 3);
+        CHECK(results.size() == 12);
+        for (const auto &[market, n] : results) {
+            CHECK(n == 1);
+        }
+
+        // a wide batch does not leave the pool widened for later calls
+        co_await api.backfill(markets(21, 28, 5), 8,
+                              [](td365::backfill_result &&) {});
+        CHECK(server.max_in_flight() > 4);
+        server.reset_max_in_flight();
+        co_await concurrent_backfills(api, 8);
+        CHECK(server.max_in_flight() == 4);
+    };
+    with_chart_host(server, ioc, test);
+}
+
+TEST_CASE("batch backfill reports a failing market and carries on",
+          "[backfill]") {
+    net::io_context ioc;
+    chart_host host;
+    host.failing = {3};
+    fake_https_server server(ioc, std::ref(host));
+    auto test = [&](td365::rest_api &api) -> net::awaitable<void> {
+        std::map<int, int> results;
+        std::map<int, bool> failed;
+        co_await api.backfill(markets(1, 6, 5), 2,
+                              [&](td365::backfill_result &&r) {
+                                  ++results[r.request.market_id];
+                                  failed[r.request.market_id] =
+                                      r.error != nullptr;
+                                  if (!r.error) {
+                                      CHECK(r.candles.size() == 5);
+                                  }
+                              });
+        REQUIRE(results.size() == 6);
+        for (int m = 1; m <= 6; ++m) {
+            CHECK(results[m] == 1);
+            CHECK(failed[m] == (m == 3));
+            CHECK(host.hits[m] == 1);
+        }
+    };
+    with_chart_host(server, ioc, test);
+}
+
+TEST_CASE("backfill returns candles oldest first", "[backfill]") {
+    net::io_context ioc;
+    chart_host host;
+    fake_https_server server(ioc, std::ref(host));
+    auto test = [&](td365::rest_api &api) -> net::awaitable<void> {
+        // the host sends newest first
+        auto candles =
+            co_await api.backfill(1, 0, 10, td365::chart_duration::m1);
+        CHECK(candles.size() == 10);
+        CHECK(consecutive(candles));
+    };
+    with_chart_host(server, ioc, test);
+}
+
+TEST_CASE("backfill with a candle cache fetches only what is missing",
+          "[backfill][candle_cache]") {
+    net::io_context ioc;
+    chart_host host;
+    fake_https_server server(ioc, std::ref(host));
+    auto test = [&](td365::rest_api &api) -> net::awaitable<void> {
+        api.set_candle_cache(std::make_unique<td365::candle_cache>(
+            cache_dir("td365_backfill_cache")));
+        constexpr auto m1 = td365::chart_duration::m1;
+
+        auto first = co_await api.backfill(7, 0, 30, m1);
+        CHECK(first.size() == 30);
+        CHECK(consecutive(first));
+
+        // moments later only the period still forming at the last fetch and
+        // the current one are asked for
+        auto second = co_await api.backfill(7, 0, 30, m1);
+        CHECK(host.lengths(7) == std::vector{30, 2});
+        CHECK(second.size() == 30);
+        CHECK(consecutive(second));
+        CHECK(second.back().timestamp >= first.back().timestamp);
+
+        // the cache holds 5 candles for this market: the short tail fetch
+        // cannot make up 50, so the whole window is fetched again
+        co_await api.backfill(8, 0, 5, m1);
+        auto wider = co_await api.backfill(8, 0, 50, m1);
+        CHECK(host.lengths(8) == std::vector{5, 2, 50});
+        CHECK(wider.size() == 50);
+        CHECK(consecutive(wider));
+    };
+    with_chart_host(server, ioc, test);
+}
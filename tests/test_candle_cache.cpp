@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/candle_cache.h>
+
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+using namespace std::chrono_literals;
+using td365::chart_duration;
+
+namespace {
+std::string cache_dir(std::string_view name) {
+    auto dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    return dir.string();
+}
+
+td365::candle_cache::time_point minute(int m) {
+    return td365::candle_cache::time_point(std::chrono::minutes(29000000 + m));
+}
+
+// `n` one minute candles ending at minute `last`, newest first like the
+// chart feed
+std::vector<td365::candle> fetch(int last, int n, double close = 0) {
+    std::vector<td365::candle> out;
+    for (int m = last; m > last - n; --m) {
+        const double price = m;
+        out.push_back({.timestamp = minute(m),
+                       .open = price,
+                       .high = price + 1,
+                       .low = price - 1,
+                       .close = close != 0 ? close : price,
+                       .volume = 1});
+    }
+    return out;
+}
+} // namespace
+
+TEST_CASE("candle_cache merges fetches and tracks coverage", "[candle_cache]") {
+    const auto dir = cache_dir("td365_candle_cache");
+
+    {
+        td365::candle_cache cache(dir);
+        REQUIRE(cache.candles(7, chart_duration::m1).empty());
+        REQUIRE(cache.ranges(7, chart_duration::m1).empty());
+
+        cache.merge(7, chart_duration::m1, fetch(10, 10), minute(10) + 30s);
+        auto held = cache.candles(7, chart_duration::m1);
+        REQUIRE(held.size() == 10);
+        REQUIRE(held.front().timestamp == minute(1));
+        REQUIRE(held.back().timestamp == minute(10));
+
+        // the tail fetch overlaps the candle that was still forming
+        cache.merge(7, chart_duration::m1, fetch(13, 4, 99), minute(13) + 5s);
+        held = cache.candles(7, chart_duration::m1);
+        REQUIRE(held.size() == 13);
+        REQUIRE(held[9].timestamp == minute(10));
+        REQUIRE(held[9].close == 99);
+        REQUIRE(held.back().timestamp == minute(13));
+
+        auto ranges = cache.ranges(7, chart_duration::m1);
+        REQUIRE(ranges.size() == 1);
+        REQUIRE(ranges[0].from == minute(1));
+        REQUIRE(ranges[0].to == minute(13) + 5s);
+    }
+
+    SECTION("survives a restart") {
+        td365::candle_cache cache(dir);
+        auto held = cache.candles(7, chart_duration::m1);
+        REQUIRE(held.size() == 13);
+        REQUIRE(held[9].close == 99);
+        REQUIRE(cache.ranges(7, chart_duration::m1).size() == 1);
+        REQUIRE(cache.candles(8, chart_duration::m1).empty());
+    }
+
+    SECTION("a fetch that does not reach back leaves a gap") {
+        td365::candle_cache cache(dir);
+        cache.merge(7, chart_duration::m1, fetch(100, 5), minute(100) + 1s);
+        REQUIRE(cache.candles(7, chart_duration::m1).size() == 18);
+        auto ranges = cache.ranges(7, chart_duration::m1);
+        REQUIRE(ranges.size() == 2);
+        REQUIRE(ranges[1].from == minute(96));
+
+        // filling the gap joins the ranges back up
+        cache.merge(7, chart_duration::m1, fetch(101, 90), minute(101) + 1s);
+        REQUIRE(cache.candles(7, chart_duration::m1).size() == 101);
+        REQUIRE(cache.ranges(7, chart_duration::m1).size() == 1);
+    }
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include "tick_fixture.h"
+#include <td365/candles.h>
+
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+// 2025-06-01 00:00:00 UTC, on an hour boundary
+const auto t0 = std::chrono::system_clock::time_point(1748736000s);
+
+td365::tick::time_type at(std::chrono::system_clock::duration offset) {
+    return std::chrono::time_point_cast<std::chrono::nanoseconds>(t0 + offset);
+}
+
+td365::candle make_candle(std::chrono::system_clock::duration offset,
+                          double o, double h, double l, double c) {
+    return {.timestamp = t0 + offset,
+            .open = o,
+            .high = h,
+            .low = l,
+            .close = c,
+            .volume = 10};
+}
+} // namespace
+
+TEST_CASE("candle_aggregator builds candles at every timeframe",
+          "[candles]") {
+    td365::candle_aggregator agg(4);
+
+    std::vector<std::pair<td365::timeframe, td365::candle>> closed;
+    agg.set_on_close([&](int, td365::timeframe tf, const td365::candle &c) {
+        closed.emplace_back(tf, c);
+    });
+
+    agg.on_tick(make_tick(1, 100, 100, at(0s)));
+    agg.on_tick(make_tick(1, 105, 105, at(200ms)));
+    agg.on_tick(make_tick(1, 98, 98, at(700ms)));
+    // closes the first 1s candle
+    agg.on_tick(make_tick(1, 101, 101, at(1500ms)));
+
+    auto s1 = agg.series(1, td365::timeframe::s1);
+    REQUIRE(s1.size() == 1);
+    REQUIRE(s1[0].open == 100);
+    REQUIRE(s1[0].high == 105);
+    REQUIRE(s1[0].low == 98);
+    REQUIRE(s1[0].close == 98);
+    REQUIRE(s1[0].volume == 3);
+    REQUIRE(s1[0].timestamp == t0);
+    REQUIRE(s1.current().open == 101);
+
+    auto m1 = agg.series(1, td365::timeframe::m1);
+    REQUIRE(m1.size() == 0);
+    REQUIRE(m1.has_current());
+    REQUIRE(m1.current().high == 105);
+    REQUIRE(m1.current().volume == 4);
+
+    REQUIRE(closed.size() == 1);
+    REQUIRE(closed[0].first == td365::timeframe::s1);
+
+    SECTION("history is a fixed ring, newest first") {
+        for (int i = 2; i < 10; ++i) {
+            agg.on_tick(make_tick(1, 100 + i, 100 + i,
+                                  at(std::chrono::seconds(i))));
+        }
+        s1 = agg.series(1, td365::timeframe::s1);
+        REQUIRE(s1.size() == 4);
+        REQUIRE(s1[0].open == 108);
+        REQUIRE(s1[3].open == 105);
+    }
+
+    SECTION("late ticks don't reopen closed candles") {
+        agg.on_tick(make_tick(1, 500, 500, at(900ms)));
+        s1 = agg.series(1, td365::timeframe::s1);
+        REQUIRE(s1[0].high == 105);
+        REQUIRE(s1.current().high == 101);
+    }
+
+    SECTION("quotes are independent") {
+        agg.on_tick(make_tick(2, 7, 7, at(3s)));
+        REQUIRE(agg.series(2, td365::timeframe::s1).size() == 0);
+        REQUIRE(agg.series(1, td365::timeframe::s1).size() == 1);
+        REQUIRE(agg.series(3, td365::timeframe::m1).size() == 0);
+    }
+}
+
+TEST_CASE("candle_aggregator seeds from backfill", "[candles]") {
+    td365::candle_aggregator agg;
+
+    // newest first, as the chart service returns them
+    std::vector<td365::candle> backfill = {
+        make_candle(6min, 12, 14, 11, 13), make_candle(5min, 10, 12, 9, 11),
+        make_candle(4min, 8, 10, 7, 9)};
+
+    bool notified = false;
+    agg.set_on_close([&](auto...) { notified = true; });
+    agg.seed(1, td365::timeframe::m1, backfill);
+    REQUIRE_FALSE(notified);
+
+    auto m1 = agg.series(1, td365::timeframe::m1);
+    REQUIRE(m1.size() == 2);
+    REQUIRE(m1[0].open == 10);
+    REQUIRE(m1[1].open == 8);
+    REQUIRE(m1.current().open == 12);
+
+    // 04:00 is in the first 5m bucket, 05:00 and 06:00 in the second
+    auto m5 = agg.series(1, td365::timeframe::m5);
+    REQUIRE(m5.size() == 1);
+    REQUIRE(m5[0].close == 9);
+    REQUIRE(m5.current().open == 10);
+    REQUIRE(m5.current().high == 14);
+    REQUIRE(m5.current().volume == 20);
+
+    REQUIRE_FALSE(agg.series(1, td365::timeframe::s1).has_current());
+
+    // a tick in the seeded minute extends it instead of starting another
+    agg.on_tick(make_tick(1, 20, 20, at(6min + 30s)));
+    m1 = agg.series(1, td365::timeframe::m1);
+    REQUIRE(m1.size() == 2);
+    REQUIRE(m1.current().high == 20);
+    REQUIRE(m1.current().open == 12);
+}
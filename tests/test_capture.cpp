@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/capture.h>
+#include <td365/types.h>
+#include <td365/ws_client.h>
+
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+using nlohmann::json;
+
+namespace {
+std::string capture_path(std::string_view name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+std::string price_frame() {
+    json j = {
+        {"t", "p"},
+        {"d",
+         {{"sp",
+           {"870964,104850.50,104910.50,-1147.00,d,1,106498.50,102786.50,"
+            "O+E4W55s4o+2dEv3T2kaaz+lkLwePRX97aJOsVcIe6c=,0,104880.50,"
+            "638854057031360000,455503",
+            "881586,6332.00,6352.00,-273.00,d,1,6670.00,6170.00,"
+            "3kbEc9JJ+n/UAYeI0qC69gReU+Wx66IEjKy9rF6nc1Q=,0,0.63,"
+            "638854056953420000,153442"}}}}};
+    return j.dump();
+}
+} // namespace
+
+TEST_CASE("capture round trip", "[capture]") {
+    const auto path = capture_path("td365_round_trip.cap");
+    const auto t0 =
+        td365::capture_frame::time_type(std::chrono::seconds(1750000000));
+
+    std::vector<std::string> frames = {price_frame(),
+                                       R"({"t":"heartbeat","d":{}})",
+                                       std::string(100000, 'x')};
+    {
+        // a tiny window forces the writer to remap several times
+        td365::capture_writer writer(path, 4096);
+        for (size_t i = 0; i < frames.size(); ++i) {
+            writer.append(t0 + std::chrono::milliseconds(i), frames[i]);
+        }
+        REQUIRE(writer.frames() == frames.size());
+    }
+
+    REQUIRE(std::filesystem::file_size(path) ==
+            16 + frames.size() * 12 + frames[0].size() + frames[1].size() +
+                frames[2].size());
+
+    td365::capture_reader reader(path);
+    td365::capture_frame frame{};
+    for (size_t i = 0; i < frames.size(); ++i) {
+        REQUIRE(reader.next(frame));
+        REQUIRE(frame.payload == frames[i]);
+        REQUIRE(frame.received == t0 + std::chrono::milliseconds(i));
+    }
+    REQUIRE_FALSE(reader.next(frame));
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("capture stops instead of throwing when the file cannot grow",
+          "[capture]") {
+    const auto path = capture_path("td365_full.cap");
+    const auto t0 =
+        td365::capture_frame::time_type(std::chrono::seconds(1750000000));
+    const auto frame = std::string(1000, 'x');
+
+    // files may not grow past 16KiB, as if the disk had filled up
+    rlimit saved{};
+    ::getrlimit(RLIMIT_FSIZE, &saved);
+    auto *old_handler = std::signal(SIGXFSZ, SIG_IGN);
+    std::uint64_t kept = 0;
+    {
+        td365::capture_writer writer(path, 4096);
+        rlimit small = saved;
+        small.rlim_cur = 16384;
+        ::setrlimit(RLIMIT_FSIZE, &small);
+        for (int i = 0; i < 64; ++i) {
+            REQUIRE_NOTHROW(
+                writer.append(t0 + std::chrono::milliseconds(i), frame));
+        }
+        ::setrlimit(RLIMIT_FSIZE, &saved);
+        CHECK(writer.failed());
+        kept = writer.frames();
+        CHECK(kept > 0);
+        CHECK(kept < 64);
+    }
+    ::setrlimit(RLIMIT_FSIZE, &saved);
+    std::signal(SIGXFSZ, old_handler);
+
+    // what was captured before the error reads back
+    td365::capture_reader reader(path);
+    td365::capture_frame f{};
+    std::uint64_t n = 0;
+    while (reader.next(f)) {
+        CHECK(f.payload == frame);
+        ++n;
+    }
+    CHECK(n == kept);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("capture replay dispatches ticks", "[capture]") {
+    const auto path = capture_path("td365_replay.cap");
+    const auto t0 =
+        td365::capture_frame::time_type(std::chrono::seconds(1750000000));
+    {
+        td365::capture_writer writer(path);
+        writer.append(t0, R"({"t":"connectResponse"})");
+        writer.append(t0 + std::chrono::milliseconds(20), price_frame());
+        writer.append(t0 + std::chrono::milliseconds(40), price_frame());
+    }
+
+    std::vector<int> quotes;
+    td365::user_callbacks callbacks;
+    callbacks.tick_cb = [&](td365::tick &&t) { quotes.push_back(t.quote_id); };
+    td365::ws_client client(callbacks);
+
+    td365::capture_reader reader(path);
+
+    SECTION("maximum speed") {
+        auto stats = td365::replay(reader, client);
+        REQUIRE(stats.frames == 3);
+        REQUIRE(quotes == std::vector<int>{870964, 881586, 870964, 881586});
+    }
+
+    SECTION("recorded speed") {
+        auto stats =
+            td365::replay(reader, client, td365::replay_speed::recorded);
+        REQUIRE(stats.frames == 3);
+        REQUIRE(stats.elapsed >= std::chrono::milliseconds(40));
+        REQUIRE(quotes.size() == 4);
+    }
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include "fake_https_server.h"
+#include <td365/http_client.h>
+#include <td365/tls.h>
+
+#include <boost/asio.hpp>
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+using namespace std::chrono_literals;
+
+namespace {
+fake_https_server::response echo_target(const fake_https_server::request &req) {
+    fake_https_server::response res{http::status::ok, req.version()};
+    res.body() = std::string(req.target());
+    return res;
+}
+
+// Runs `test` against a fresh server until it returns.
+void with_server(fake_https_server::options opts,
+                 std::function<net::awaitable<void>(fake_https_server &)> test) {
+    net::io_context ioc;
+    fake_https_server server(ioc, echo_target, opts);
+    ::setenv("PROXY", server.url().c_str(), 1);
+
+    net::co_spawn(ioc, server.run(), net::detached);
+    net::co_spawn(
+        ioc,
+        [&]() -> net::awaitable<void> {
+            co_await test(server);
+            server.stop();
+        },
+        [](std::exception_ptr e) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        });
+    ioc.run();
+    ::unsetenv("PROXY");
+}
+
+std::string_view body(const td365::http_response &res) { return res.body(); }
+} // namespace
+
+TEST_CASE("http_client reuses one connection for sequential requests",
+          "[http_client]") {
+    with_server({}, [](fake_https_server &server) -> net::awaitable<void> {
+        td365::http_client client(co_await net::this_coro::executor,
+                                  "localhost");
+        for (int i = 0; i < 5; ++i) {
+            auto res = co_await client.get(std::format("/seq/{}", i));
+            CHECK(body(res) == std::format("/seq/{}", i));
+        }
+        CHECK(server.accepted() == 1);
+        CHECK(client.connections() == 1);
+    });
+}
+
+TEST_CASE("http_client runs concurrent requests on separate connections",
+          "[http_client]") {
+    with_server({.delay = 50ms}, [](fake_https_server &server)
+                    -> net::awaitable<void> {
+        auto ex = co_await net::this_coro::executor;
+        td365::http_client client(ex, "localhost", {.max_connections = 3});
+
+        int done = 0;
+        net::steady_timer all_done(ex, net::steady_timer::time_point::max());
+        for (int i = 0; i < 7; ++i) {
+            net::co_spawn(
+                ex,
+                [&, i]() -> net::awaitable<void> {
+                    auto res = co_await client.get(std::format("/c/{}", i));
+                    CHECK(body(res) == std::format("/c/{}", i));
+                    if (++done == 7) {
+                        all_done.cancel();
+                    }
+                },
+                net::detached);
+        }
+        boost::system::error_code ec;
+        co_await all_done.async_wait(net::redirect_error(net::use_awaitable, ec));
+
+        CHECK(done == 7);
+        CHECK(server.accepted() == 3);
+        CHECK(server.max_in_flight() == 3);
+        CHECK(client.connections() == 3);
+    });
+}
+
+TEST_CASE("http_client replaces connections the server closed",
+          "[http_client]") {
+    with_server({}, [](fake_https_server &server) -> net::awaitable<void> {
+        auto ex = co_await net::this_coro::executor;
+        td365::http_client client(ex, "localhost");
+
+        auto one = co_await client.get("/one");
+        CHECK(body(one) == "/one");
+        server.close_idle();
+        net::steady_timer settle(ex, 20ms);
+        co_await settle.async_wait(net::use_awaitable);
+
+        auto two = co_await client.get("/two");
+        CHECK(body(two) == "/two");
+        CHECK(server.accepted() == 2);
+        CHECK(client.connections() == 1);
+    });
+}
+
+TEST_CASE("http_client evicts connections idle past max_idle",
+          "[http_client]") {
+    with_server({}, [](fake_https_server &server) -> net::awaitable<void> {
+        auto ex = co_await net::this_coro::executor;
+        td365::http_client client(ex, "localhost", {.max_idle = 0s});
+
+        for (int i = 0; i < 3; ++i) {
+            net::steady_timer idle(ex, 5ms);
+            co_await idle.async_wait(net::use_awaitable);
+            auto res = co_await client.get("/idle");
+            CHECK(body(res) == "/idle");
+        }
+        CHECK(server.accepted() == 3);
+        CHECK(client.connections() == 1);
+    });
+}
+
+TEST_CASE("http_client resumes TLS sessions on new connections",
+          "[http_client]") {
+    with_server({}, [](fake_https_server &server) -> net::awaitable<void> {
+        auto ex = co_await net::this_coro::executor;
+        td365::http_client client(ex, "localhost", {.max_idle = 0s});
+        const auto before = td365::read_tls_stats();
+
+        for (int i = 0; i < 3; ++i) {
+            net::steady_timer idle(ex, 5ms);
+            co_await idle.async_wait(net::use_awaitable);
+            auto res = co_await client.get("/resume");
+            CHECK(body(res) == "/resume");
+        }
+        const auto after = td365::read_tls_stats();
+        CHECK(server.accepted() == 3);
+        CHECK(after.handshakes - before.handshakes == 3);
+        // the first connection can't resume: the session cached by an
+        // earlier test belongs to another server
+        CHECK(after.resumed - before.resumed == 2);
+    });
+}
+
+TEST_CASE("http_client keeps a warm connection ready", "[http_client]") {
+    with_server({}, [](fake_https_server &server) -> net::awaitable<void> {
+        auto ex = co_await net::this_coro::executor;
+        td365::http_client client(ex, "localhost");
+
+        // opened ahead of the first request, without sending anything
+        co_await client.warm("/ping", 60s);
+        CHECK(client.connections() == 1);
+        CHECK(server.accepted() == 1);
+        CHECK(server.requests() == 0);
+
+        auto res = co_await client.get("/order");
+        CHECK(body(res) == "/order");
+        CHECK(server.accepted() == 1);
+
+        // reopened once the server drops it
+        server.close_idle();
+        net::steady_timer settle(ex, 20ms);
+        co_await settle.async_wait(net::use_awaitable);
+        co_await client.warm("/ping", 60s);
+        CHECK(server.accepted() == 2);
+        CHECK(client.connections() == 1);
+
+        // refreshed once idle for `refresh`
+        co_await client.warm("/ping", 0s);
+        CHECK(server.requests() == 2);
+        CHECK(server.accepted() == 2);
+    });
+}
+
+TEST_CASE("http_client streams a body to the handler", "[http_client]") {
+    with_server({}, [](fake_https_server &) -> net::awaitable<void> {
+        td365::http_client client(co_await net::this_coro::executor,
+                                  "localhost");
+        std::string got;
+        auto hdr = co_await client.get_streamed(
+            "/streamed", [&](std::string_view chunk) { got += chunk; });
+        CHECK(hdr.result() == http::status::ok);
+        CHECK(got == "/streamed");
+        CHECK(client.connections() == 1);
+    });
+}
+
+TEST_CASE("http_client times when a request was written and answered",
+          "[http_client]") {
+    with_server({}, [](fake_https_server &) -> net::awaitable<void> {
+        td365::http_client client(co_await net::this_coro::executor,
+                                  "localhost");
+        const auto before = std::chrono::steady_clock::now();
+        td365::request_timing timing;
+        auto res = co_await client.post("/timed", "{}", std::nullopt, &timing);
+        const auto after = std::chrono::steady_clock::now();
+        CHECK(body(res) == "/timed");
+        CHECK(before <= timing.written);
+        CHECK(timing.written <= timing.first_byte);
+        CHECK(timing.first_byte <= after);
+    });
+}
+
+TEST_CASE("http_client decodes concurrent bodies on their own connections",
+          "[http_client]") {
+    with_server({.delay = 50ms}, [](fake_https_server &server)
+                    -> net::awaitable<void> {
+        auto ex = co_await net::this_coro::executor;
+        td365::http_client client(ex, "localhost", {.max_connections = 3});
+
+        int done = 0;
+        net::steady_timer all_done(ex, net::steady_timer::time_point::max());
+        for (int i = 0; i < 3; ++i) {
+            net::co_spawn(
+                ex,
+                [&, i]() -> net::awaitable<void> {
+                    std::string got;
+                    auto hdr = co_await client.post_decoded(
+                        std::format("/d/{}", i), "{}",
+                        [&](std::string_view b) { got = b; });
+                    CHECK(hdr.result() == http::status::ok);
+                    CHECK(got == std::format("/d/{}", i));
+                    if (++done == 3) {
+                        all_done.cancel();
+                    }
+                },
+                net::detached);
+        }
+        boost::system::error_code ec;
+        co_await all_done.async_wait(net::redirect_error(net::use_awaitable, ec));
+
+        CHECK(done == 3);
+        CHECK(server.max_in_flight() == 3);
+    });
+}
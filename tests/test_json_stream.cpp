@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/inflate.h>
+#include <td365/json_stream.h>
+#include <td365/utils.h>
+
+#include <catch2/catch_all.hpp>
+#include <format>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+namespace {
+std::vector<std::string> split(std::string_view key, std::string_view doc,
+                               std::size_t piece) {
+    std::vector<std::string> out;
+    td365::json_array_stream s(std::string(key), [&](std::string_view e) {
+        out.emplace_back(e);
+    });
+    for (std::size_t i = 0; i < doc.size(); i += piece) {
+        s.feed(doc.substr(i, piece));
+    }
+    CHECK(s.done());
+    return out;
+}
+
+std::string gzip(std::string_view in) {
+    z_stream zs{};
+    REQUIRE(deflateInit2(&zs, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8,
+                         Z_DEFAULT_STRATEGY) == Z_OK);
+    std::string out(deflateBound(&zs, static_cast<uLong>(in.size())), '\0');
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+    zs.avail_in = static_cast<uInt>(in.size());
+    zs.next_out = reinterpret_cast<Bytef *>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+    REQUIRE(deflate(&zs, Z_FINISH) == Z_STREAM_END);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+} // namespace
+
+TEST_CASE("json_array_stream yields the elements of the keyed array",
+          "[json_stream]") {
+    const std::string doc =
+        R"({"x": {"d": [0]}, "s": "d", "d" : [ {"a": [1, 2], "b": "}]"} ,)"
+        R"( "q\"],", 12.5e3, [], null ], "after": [9]})";
+    const std::vector<std::string> want = {
+        R"({"a": [1, 2], "b": "}]"})", R"("q\"],")", "12.5e3", "[]",
+        "null"};
+
+    for (std::size_t piece : {doc.size(), std::size_t{1}, std::size_t{7}}) {
+        INFO("piece " << piece);
+        CHECK(split("d", doc, piece) == want);
+    }
+}
+
+TEST_CASE("json_array_stream handles a root array and empty arrays",
+          "[json_stream]") {
+    CHECK(split("", R"([1,"two",{"three":3}])", 2) ==
+          std::vector<std::string>{"1", R"("two")", R"({"three":3})"});
+    CHECK(split("", "[ ]", 1).empty());
+    CHECK(split("data", R"({"data":[]})", 3).empty());
+}
+
+TEST_CASE("gzip_inflater and json_array_stream decode a body in pieces",
+          "[json_stream]") {
+    nlohmann::json doc;
+    for (int i = 0; i < 20000; ++i) {
+        doc["d"].push_back({{"id", i}, {"name", std::format("market {}", i)}});
+    }
+    const auto body = gzip(doc.dump());
+
+    std::vector<int> ids;
+    td365::json_array_stream s("d", [&](std::string_view e) {
+        ids.push_back(nlohmann::json::parse(e).at("id").get<int>());
+    });
+    td365::gzip_inflater z;
+    for (std::size_t i = 0; i < body.size(); i += 1000) {
+        z.feed(std::string_view(body).substr(i, 1000),
+               [&](std::string_view out) { s.feed(out); });
+    }
+
+    CHECK(z.done());
+    CHECK(s.done());
+    REQUIRE(ids.size() == 20000);
+    for (int i = 0; i < 20000; ++i) {
+        CHECK(ids[static_cast<std::size_t>(i)] == i);
+    }
+
+    td365::gzip_inflater bad;
+    CHECK_THROWS(bad.feed("not gzip at all", [](std::string_view) {}));
+}
+
+TEST_CASE("get_http_body inflates a gzip response into a reused buffer",
+          "[json_stream]") {
+    std::string plain;
+    for (int i = 0; i < 5000; ++i) {
+        plain += std::format("{{\"id\":{}}},", i);
+    }
+    const auto gz = gzip(plain);
+
+    td365::http_response res{boost::beast::http::status::ok, 11};
+    res.set(boost::beast::http::field::content_encoding, "gzip");
+    res.body() = gz;
+
+    std::string buffer;
+    CHECK(td365::get_http_body(res, buffer) == plain);
+    const auto *data = buffer.data();
+    CHECK(td365::get_http_body(res, buffer) == plain);
+    CHECK(buffer.data() == data);
+    CHECK(td365::get_http_body(res) == plain);
+
+    // an uncompressed body is handed back in place
+    res.set(boost::beast::http::field::content_encoding, "identity");
+    CHECK(td365::get_http_body(res, buffer).data() == res.body().data());
+    CHECK(td365::get_http_body(res) == gz);
+}
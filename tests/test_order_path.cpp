@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include "fake_https_server.h"
+#include "fake_trading_host.h"
+#include "fake_venue.h"
+#include <td365/rest_api.h>
+#include <td365/td365.h>
+#include <td365/types.h>
+#include <td365/ws_client.h>
+
+#include <boost/asio.hpp>
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <string>
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+using nlohmann::json;
+using namespace std::chrono_literals;
+
+namespace {
+std::string price_frame() {
+    json j = {
+        {"t", "p"},
+        {"d",
+         {{"sp",
+           {"870964,104850.50,104910.50,-1147.00,d,1,106498.50,102786.50,"
+            "O+E4W55s4o+2dEv3T2kaaz+lkLwePRX97aJOsVcIe6c=,0,104880.50,"
+            "638854057031360000,455503",
+            "881586,6332.00,6352.00,-273.00,d,1,6670.00,6170.00,"
+            "3kbEc9JJ+n/UAYeI0qC69gReU+Wx66IEjKy9rF6nc1Q=,0,0.63,"
+            "638854056953420000,153442"}}}}};
+    return j.dump();
+}
+
+// Runs `test` with a rest_api connected to `host` until it returns.
+void with_host(trading_host &host,
+               std::function<net::awaitable<void>(td365::rest_api &)> test) {
+    net::io_context ioc;
+    fake_https_server server(ioc, std::ref(host));
+    ::setenv("PROXY", server.url().c_str(), 1);
+
+    net::co_spawn(ioc, server.run(), net::detached);
+    net::co_spawn(
+        ioc,
+        [&]() -> net::awaitable<void> {
+            auto api = std::make_shared<td365::rest_api>();
+            co_await api->connect(
+                boost::urls::url("https://localhost/Advanced.aspx?ots=OTS"));
+            co_await test(*api);
+            server.stop();
+        },
+        [](std::exception_ptr e) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        });
+    ioc.run();
+    ::unsetenv("PROXY");
+}
+
+td365::trade_request order(int market_id) {
+    return td365::trade_request{.dir = td365::trade_request::direction::buy,
+                                .market_id = market_id,
+                                .quote_id = market_id * 10,
+                                .price = 100.5,
+                                .stake = 1,
+                                .stop = 0,
+                                .limit = 0,
+                                .key = "key"};
+}
+} // namespace
+
+TEST_CASE("ticks leave the latest order key per quote", "[order]") {
+    td365::user_callbacks callbacks;
+    callbacks.tick_cb = [](td365::tick &&) {};
+    td365::ws_client client(callbacks);
+
+    REQUIRE(client.order_key(870964) == nullptr);
+    client.replay(price_frame());
+    REQUIRE(client.order_key(870964) != nullptr);
+    CHECK(*client.order_key(870964) ==
+          "O+E4W55s4o+2dEv3T2kaaz+lkLwePRX97aJOsVcIe6c=");
+    CHECK(*client.order_key(881586) ==
+          "3kbEc9JJ+n/UAYeI0qC69gReU+Wx66IEjKy9rF6nc1Q=");
+    CHECK(client.order_key(1) == nullptr);
+}
+
+TEST_CASE("place_order reuses market details within details_ttl", "[order]") {
+    trading_host host;
+    with_host(host, [&](td365::rest_api &api) -> net::awaitable<void> {
+        td365::order_options opts;
+        opts.simulate = false;
+        opts.details_ttl = 5min;
+        api.set_order_options(opts);
+        co_await api.place_order(order(1));
+        co_await api.place_order(order(1));
+        CHECK(host.details() == 1);
+        co_await api.place_order(order(2));
+        CHECK(host.details() == 2);
+
+        // a zero ttl fetches them for every order
+        opts.details_ttl = 0s;
+        api.set_order_options(opts);
+        co_await api.place_order(order(1));
+        co_await api.place_order(order(1));
+        CHECK(host.details() == 4);
+        CHECK(host.trades() == 5);
+    });
+}
+
+TEST_CASE("place_order drops cached details after a failed order",
+          "[order]") {
+    trading_host host;
+    with_host(host, [&](td365::rest_api &api) -> net::awaitable<void> {
+        api.set_order_options(td365::order_options::fast());
+        co_await api.place_order(order(1));
+        CHECK(host.details() == 1);
+
+        host.fail_trades = true;
+        bool failed = false;
+        try {
+            co_await api.place_order(order(1));
+        } catch (const std::exception &) {
+            failed = true;
+        }
+        CHECK(failed);
+        CHECK(host.details() == 1);
+
+        host.fail_trades = false;
+        co_await api.place_order(order(1));
+        CHECK(host.details() == 2);
+        CHECK(host.trades() == 3);
+    });
+}
+
+TEST_CASE("fast orders skip the simulate request", "[order]") {
+    trading_host host;
+    with_host(host, [&](td365::rest_api &api) -> net::awaitable<void> {
+        co_await api.place_order(order(1));
+        CHECK(host.simulates() == 1);
+
+        api.set_order_options(td365::order_options::fast());
+        co_await api.place_order(order(1));
+        co_await api.place_order(order(1));
+        CHECK(host.simulates() == 1);
+        CHECK(host.trades() == 3);
+    });
+}
+
+TEST_CASE("a throwing trade callback leaves one trace for the order",
+          "[order]") {
+    fake_venue venue;
+    net::io_context ioc;
+    td365::td365 client(ioc.get_executor());
+    REQUIRE(connect_to(client, venue, ioc));
+
+    int called = 0;
+    client.callbacks().trade_response_cb = [&](td365::trade_response &&) {
+        ++called;
+        throw std::runtime_error("callback bug");
+    };
+    client.trade(order(1));
+    bool stopped = false;
+    client.async_stop([&](std::exception_ptr e) { stopped = !e; });
+    ioc.run_for(10s);
+    REQUIRE(stopped);
+
+    CHECK(called == 1);
+    const auto traces = client.drain_order_traces();
+    REQUIRE(traces.size() == 1);
+    CHECK(traces[0].ok);
+    CHECK(venue.host.trades() == 1);
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/order_template.h>
+
+#include <catch2/catch_all.hpp>
+#include <nlohmann/json.hpp>
+#include <string>
+
+namespace {
+// the body rest_api used to build for every order
+std::string json_body(const td365::trade_request &request) {
+    nlohmann::json body = {
+        {"marketID", request.market_id},
+        {"quoteID", request.quote_id},
+        {"price", request.price},
+        {"stake", std::to_string(request.stake)},
+        {"tradeType", 1},
+        {"tradeMode", request.dir == td365::trade_request::direction::sell},
+        {"hasClosingOrder", true},
+        {"isGuaranteed", false},
+        {"orderModeID", 3},
+        {"orderTypeID", 2},
+        {"orderPriceModeID", 2},
+        {"limitOrderPrice", std::to_string(request.limit)},
+        {"stopOrderPrice", std::to_string(request.stop)},
+        {"trailingPoint", 0},
+        {"closePositionID", 0},
+        {"isKaazingFeed", true},
+        {"userAgent", "Firefox (139.0)"},
+        {"key", request.key}};
+    return body.dump();
+}
+
+td365::trade_request request(double price, double stake,
+                             td365::trade_request::direction dir) {
+    return {.dir = dir,
+            .market_id = 870964,
+            .quote_id = 455503,
+            .price = price,
+            .stake = stake,
+            .stop = price - 25.5,
+            .limit = price + 40,
+            .key = "O+E4W55s4o+2dEv3T2kaaz+lkLwePRX97aJOsVcIe6c="};
+}
+} // namespace
+
+TEST_CASE("order_template renders the same body as nlohmann::json",
+          "[order_template]") {
+    using dir = td365::trade_request::direction;
+    td365::order_template tmpl(870964, 455503);
+
+    for (double price : {104850.5, 104880.0, 6332.25, 0.63, 1.23456789, 0.0001,
+                         123456789012.5}) {
+        for (double stake : {0.1, 1.0, 2.5}) {
+            for (auto d : {dir::buy, dir::sell}) {
+                const auto r = request(price, stake, d);
+                CHECK(tmpl.render(r) == json_body(r));
+
+                auto body = std::string("stale");
+                tmpl.render(r, body);
+                CHECK(body == json_body(r));
+            }
+        }
+    }
+}
+
+TEST_CASE("order_template rejects what it can't render", "[order_template]") {
+    using dir = td365::trade_request::direction;
+    td365::order_template tmpl(870964, 455503);
+
+    auto other_market = request(1.5, 1, dir::buy);
+    other_market.market_id = 1;
+    CHECK_THROWS(tmpl.render(other_market));
+
+    auto quoted_key = request(1.5, 1, dir::buy);
+    quoted_key.key = R"(abc"def)";
+    CHECK_THROWS(tmpl.render(quoted_key));
+
+    CHECK_THROWS(tmpl.render(request(1e20, 1, dir::buy)));
+}
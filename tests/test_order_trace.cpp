@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/order_trace.h>
+
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <vector>
+
+using namespace std::chrono_literals;
+using td365::order_stage;
+
+TEST_CASE("order_trace measures between stages it reached", "[order_trace]") {
+    td365::order_trace trace;
+    const auto t0 = td365::order_trace::clock::now();
+    trace.at[static_cast<std::size_t>(order_stage::submitted)] = t0;
+    trace.at[static_cast<std::size_t>(order_stage::trade_sent)] = t0 + 3ms;
+    trace.at[static_cast<std::size_t>(order_stage::trade_done)] = t0 + 10ms;
+
+    CHECK(trace.reached(order_stage::trade_sent));
+    CHECK_FALSE(trace.reached(order_stage::simulate_sent));
+    CHECK(trace.between(order_stage::submitted, order_stage::trade_done) ==
+          10ms);
+    CHECK(trace.between(order_stage::trade_sent, order_stage::trade_done) ==
+          7ms);
+    // skipped steps give zero rather than a bogus interval
+    CHECK(trace.between(order_stage::simulate_sent,
+                        order_stage::simulate_done) == 0ms);
+}
+
+TEST_CASE("order_trace_log drains in order and drops the oldest",
+          "[order_trace]") {
+    td365::order_trace_log log(3);
+    for (std::uint64_t id = 1; id <= 5; ++id) {
+        log.push({.id = id});
+    }
+    CHECK(log.dropped() == 2);
+
+    std::vector<td365::order_trace> out;
+    log.drain(out);
+    REQUIRE(out.size() == 3);
+    CHECK(out[0].id == 3);
+    CHECK(out[2].id == 5);
+
+    log.push({.id = 6});
+    log.drain(out);
+    REQUIRE(out.size() == 4);
+    CHECK(out[3].id == 6);
+
+    log.drain(out);
+    CHECK(out.size() == 4);
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include "tick_fixture.h"
+#include <td365/quote_cache.h>
+
+#include <atomic>
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+td365::tick::time_type at_ns(std::int64_t ns) {
+    return td365::tick::time_type(std::chrono::nanoseconds(ns));
+}
+} // namespace
+
+TEST_CASE("quote_cache stores the latest tick per quote", "[quote_cache]") {
+    td365::quote_cache cache(8);
+
+    REQUIRE_FALSE(cache.get(42).has_value());
+
+    cache.update(make_tick(42, 100.0, 101.0, at_ns(1000)));
+    cache.update(make_tick(43, 200.0, 201.0, at_ns(1000)));
+    cache.update(make_tick(42, 101.0, 102.0, at_ns(2000)));
+
+    auto q = cache.get(42);
+    REQUIRE(q.has_value());
+    REQUIRE(q->bid == 101.0);
+    REQUIRE(q->ask == 102.0);
+    REQUIRE(q->timestamp.time_since_epoch().count() == 2000);
+    REQUIRE(cache.get(43)->bid == 200.0);
+    REQUIRE(cache.size() == 2);
+
+    SECTION("older ticks are ignored") {
+        cache.update(make_tick(42, 99.0, 100.0, at_ns(1500)));
+        REQUIRE(cache.get(42)->bid == 101.0);
+    }
+
+    SECTION("quotes beyond capacity are dropped") {
+        for (int i = 0; i < 16; ++i) {
+            cache.update(make_tick(1000 + i, 1.0, 2.0, at_ns(1)));
+        }
+        REQUIRE(cache.size() == 8);
+        REQUIRE(cache.get(42).has_value());
+    }
+}
+
+TEST_CASE("quote_cache readers never see a torn update", "[quote_cache]") {
+    td365::quote_cache cache;
+    constexpr int quotes = 4;
+    constexpr int updates = 200000;
+
+    std::atomic<bool> done = false;
+    std::atomic<int> torn = 0;
+    std::atomic<std::uint64_t> reads = 0;
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                for (int q = 1; q <= quotes; ++q) {
+                    auto v = cache.get(q);
+                    if (!v) {
+                        continue;
+                    }
+                    // every write keeps ask = bid + 1 and timestamp = bid
+                    if (v->ask != v->bid + 1.0 ||
+                        v->timestamp.time_since_epoch().count() !=
+                            static_cast<std::int64_t>(v->bid)) {
+                        torn++;
+                    }
+                    reads++;
+                }
+            }
+        });
+    }
+
+    for (int i = 1; i <= updates; ++i) {
+        cache.update(make_tick(i % quotes + 1, i, i + 1, at_ns(i)));
+    }
+    // on a single CPU the writer can finish before any reader is scheduled
+    while (reads.load() == 0) {
+        std::this_thread::yield();
+    }
+    done = true;
+    for (auto &t : readers) {
+        t.join();
+    }
+
+    REQUIRE(torn.load() == 0);
+    REQUIRE(reads.load() > 0);
+    REQUIRE(cache.get(updates % quotes + 1)->bid == updates);
+}
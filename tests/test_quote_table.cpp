@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include "tick_fixture.h"
+#include <td365/quote_table.h>
+
+#include <algorithm>
+#include <atomic>
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+td365::tick::time_type at_ns(std::int64_t ns) {
+    return td365::tick::time_type(std::chrono::nanoseconds(ns));
+}
+} // namespace
+
+TEST_CASE("quote_table publishes columnar snapshots", "[quote_table]") {
+    td365::quote_table table;
+
+    REQUIRE(table.acquire().size() == 0);
+
+    table.update(make_tick(10, 100.0, 101.0, at_ns(1)));
+    table.update(make_tick(20, 200.0, 201.0, at_ns(1)));
+    table.update(make_tick(10, 102.0, 103.0, at_ns(2)));
+    table.publish();
+
+    {
+        auto snap = table.acquire();
+        REQUIRE(snap.size() == 2);
+        REQUIRE(snap.quote_id()[0] == 10);
+        REQUIRE(snap.bid()[0] == 102.0);
+        REQUIRE(snap.timestamp()[0] == 2);
+
+        // the kind of scan this is for: spread as a fraction of mid
+        double widest = 0;
+        for (std::size_t i = 0; i < snap.size(); ++i) {
+            widest = std::max(widest, (snap.ask()[i] - snap.bid()[i]) /
+                                          snap.mid_price()[i]);
+        }
+        REQUIRE(widest == Catch::Approx(1.0 / 102.5));
+    }
+
+    SECTION("a held snapshot defers publishing into its buffer") {
+        auto held = table.acquire();
+        const auto v1 = held.version();
+
+        table.update(make_tick(10, 103.0, 104.0, at_ns(3)));
+        table.publish(); // into the free buffer
+        REQUIRE(table.acquire().bid()[0] == 103.0);
+
+        table.update(make_tick(10, 104.0, 105.0, at_ns(4)));
+        table.publish(); // the other buffer is `held`: skipped
+        REQUIRE(table.acquire().bid()[0] == 103.0);
+        REQUIRE(held.bid()[0] == 102.0);
+        REQUIRE(held.version() == v1);
+
+        {
+            auto gone = std::move(held);
+        }
+        table.publish();
+        auto latest = table.acquire();
+        REQUIRE(latest.bid()[0] == 104.0);
+        REQUIRE(latest.version() > v1);
+    }
+}
+
+TEST_CASE("quote_table snapshots are consistent under load",
+          "[quote_table]") {
+    td365::quote_table table;
+    constexpr int quotes = 200;
+    constexpr int updates = 200000;
+
+    std::atomic<bool> done = false;
+    std::atomic<int> torn = 0;
+    std::atomic<int> went_back = 0;
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; ++r) {
+        readers.emplace_back([&] {
+            std::uint64_t last = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                auto snap = table.acquire();
+                if (snap.version() < last) {
+                    went_back++;
+                }
+                last = snap.version();
+                for (std::size_t i = 0; i < snap.size(); ++i) {
+                    if (snap.ask()[i] != snap.bid()[i] + 1.0) {
+                        torn++;
+                    }
+                }
+            }
+        });
+    }
+
+    for (int i = 1; i <= updates; ++i) {
+        table.update(make_tick(i % quotes, i, i + 1, at_ns(i)));
+        if (i % 10 == 0) {
+            table.publish();
+        }
+    }
+    done = true;
+    for (auto &t : readers) {
+        t.join();
+    }
+    table.publish();
+
+    REQUIRE(torn.load() == 0);
+    REQUIRE(went_back.load() == 0);
+    auto snap = table.acquire();
+    REQUIRE(snap.size() == quotes);
+}
+
+TEST_CASE("quote_table ignores ticks older than the row",
+          "[quote_table]") {
+    td365::quote_table table;
+
+    table.update(make_tick(10, 102.0, 103.0, at_ns(20)));
+    // a delayed stream delivers an earlier price
+    table.update(make_tick(10, 99.0, 100.0, at_ns(10)));
+    table.publish();
+    REQUIRE(table.acquire().bid()[0] == 102.0);
+    REQUIRE(table.acquire().timestamp()[0] == 20);
+
+    // same timestamp is not stale: the later arrival wins
+    table.update(make_tick(10, 101.0, 102.0, at_ns(20)));
+    table.publish();
+    REQUIRE(table.acquire().bid()[0] == 101.0);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include <td365/resolver.h>
+
+#include <boost/asio.hpp>
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+using namespace std::chrono_literals;
+
+namespace {
+void run(std::function<net::awaitable<void>()> test) {
+    net::io_context ioc;
+    net::co_spawn(ioc, test(), [](std::exception_ptr e) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    });
+    ioc.run();
+}
+
+// A loopback port nothing listens on, so connecting is refused at once.
+tcp::endpoint refused_endpoint(net::io_context &ioc) {
+    tcp::acceptor a(ioc, {net::ip::address_v4::loopback(), 0});
+    return a.local_endpoint();
+}
+} // namespace
+
+TEST_CASE("td_resolve answers repeat lookups from the cache", "[resolver]") {
+    run([]() -> net::awaitable<void> {
+        const auto before = td365::read_resolver_stats();
+        auto first = co_await td365::td_resolve("localhost", "40001");
+        auto second = co_await td365::td_resolve("localhost", "40001");
+        CHECK(first == second);
+
+        td365::forget_resolved("localhost", "40001");
+        co_await td365::td_resolve("localhost", "40001");
+        co_await td365::td_resolve("localhost", "40002", {.dns_ttl = 0s});
+        co_await td365::td_resolve("localhost", "40002", {.dns_ttl = 0s});
+
+        const auto after = td365::read_resolver_stats();
+        CHECK(after.lookups - before.lookups == 5);
+        CHECK(after.cache_hits - before.cache_hits == 1);
+    });
+}
+
+TEST_CASE("race_connect moves past endpoints that fail or stall",
+          "[resolver]") {
+    net::io_context ioc;
+    tcp::acceptor live(ioc, {net::ip::address_v4::loopback(), 0});
+    const auto refused = refused_endpoint(ioc);
+
+    net::co_spawn(
+        ioc,
+        [&]() -> net::awaitable<void> {
+            // TEST-NET-1 is never routed: the attempt stalls or fails
+            const std::vector<tcp::endpoint> endpoints{
+                {net::ip::make_address("192.0.2.1"), 443},
+                refused,
+                live.local_endpoint()};
+            const auto start = std::chrono::steady_clock::now();
+            auto socket = co_await td365::race_connect(
+                endpoints, {.attempt_delay = 50ms, .timeout = 10s});
+            CHECK(socket.remote_endpoint() == live.local_endpoint());
+            CHECK(std::chrono::steady_clock::now() - start < 2s);
+        },
+        [](std::exception_ptr e) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        });
+    ioc.run();
+}
+
+TEST_CASE("race_connect reports failure when nothing connects",
+          "[resolver]") {
+    net::io_context ioc;
+    const auto refused = refused_endpoint(ioc);
+    bool threw = false;
+
+    net::co_spawn(
+        ioc,
+        [&]() -> net::awaitable<void> {
+            const std::vector<tcp::endpoint> endpoints{refused};
+            try {
+                co_await td365::race_connect(endpoints);
+            } catch (const boost::system::system_error &e) {
+                threw = e.code() == net::error::connection_refused;
+            }
+        },
+        net::detached);
+    ioc.run();
+    CHECK(threw);
+}
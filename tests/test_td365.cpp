@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include "fake_venue.h"
+#include <td365/td365.h>
+
+#include <boost/asio.hpp>
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace net = boost::asio;
+using namespace std::chrono_literals;
+
+TEST_CASE("td365 async_stop waits for orders in flight",
+          "[td365][executor]") {
+    net::io_context ioc;
+    auto work = net::make_work_guard(ioc);
+    std::thread loop([&ioc] { ioc.run(); });
+
+    auto client = std::make_unique<td365::td365>(ioc.get_executor());
+
+    // hold the loop up so the orders are still queued when stop is asked
+    std::promise<void> release;
+    net::post(ioc, [held = release.get_future().share()] { held.wait(); });
+    for (int i = 0; i < 3; ++i) {
+        client->trade(td365::trade_request{
+            .dir = td365::trade_request::direction::buy,
+            .market_id = 1,
+            .quote_id = 1,
+            .price = 100,
+            .stake = 1,
+            .stop = 0,
+            .limit = 0,
+            .key = ""});
+    }
+
+    auto stopped = client->async_stop(net::use_future);
+    // waits for the orders, which can't run yet
+    CHECK(stopped.wait_for(200ms) == std::future_status::timeout);
+
+    release.set_value();
+    CHECK(stopped.wait_for(5s) == std::future_status::ready);
+    client.reset();
+
+    // the loop is the caller's, and is still running
+    std::promise<void> ran;
+    net::post(ioc, [&ran] { ran.set_value(); });
+    CHECK(ran.get_future().wait_for(5s) == std::future_status::ready);
+
+    work.reset();
+    loop.join();
+}
+
+TEST_CASE("td365 async_stop lets the caller's io_context run out of work",
+          "[td365][executor]") {
+    fake_venue venue;
+    net::io_context ioc;
+    td365::td365 client(ioc.get_executor());
+    REQUIRE(connect_to(client, venue, ioc));
+
+    bool stopped = false;
+    client.async_stop([&](std::exception_ptr e) { stopped = !e; });
+    // returns once the feed and the order-path warmer have finished
+    const auto start = std::chrono::steady_clock::now();
+    ioc.run_for(10s);
+    CHECK(std::chrono::steady_clock::now() - start < 5s);
+    CHECK(stopped);
+}
+
+TEST_CASE("td365 destroyed after the caller's io_context stopped",
+          "[td365][executor]") {
+    fake_venue venue;
+    net::io_context ioc;
+    auto client = std::make_unique<td365::td365>(ioc.get_executor());
+    REQUIRE(connect_to(*client, venue, ioc));
+
+    // the feed and warmer are still running, on a loop nobody runs any
+    // more: the destructor must not wait for them
+    auto destroyed =
+        std::async(std::launch::async, [&] { client.reset(); });
+    CHECK(destroyed.wait_for(5s) == std::future_status::ready);
+}
+
+TEST_CASE("td365 async requests complete through a callback",
+          "[td365][token]") {
+    fake_venue venue;
+    net::io_context ioc;
+    td365::td365 client(ioc.get_executor());
+    REQUIRE(connect_to(client, venue, ioc));
+
+    std::exception_ptr error;
+    std::optional<td365::market_details_response> details;
+    client.async_get_market_details(
+        1, [&](std::exception_ptr e, td365::market_details_response r) {
+            error = e;
+            details = std::move(r);
+        });
+    bool stopped = false;
+    client.async_stop([&](std::exception_ptr e) { stopped = !e; });
+    ioc.run_for(10s);
+    CHECK_FALSE(error);
+    CHECK(details.has_value());
+    CHECK(stopped);
+    CHECK(venue.host.details() == 1);
+}
+
+TEST_CASE("td365 async requests complete through use_awaitable",
+          "[td365][token]") {
+    fake_venue venue;
+    net::io_context ioc;
+    td365::td365 client(ioc.get_executor());
+    REQUIRE(connect_to(client, venue, ioc));
+
+    std::vector<td365::market_group> groups;
+    net::co_spawn(
+        ioc,
+        [&]() -> net::awaitable<void> {
+            groups = co_await client.async_get_market_super_group(
+                net::use_awaitable);
+            co_await client.async_stop(net::use_awaitable);
+        },
+        [](std::exception_ptr e) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        });
+    ioc.run_for(10s);
+    REQUIRE(groups.size() == 1);
+    CHECK(groups[0].id == 1);
+    CHECK(groups[0].name == "Indices");
+}
+
+TEST_CASE("td365 async_stop waits for async requests in flight",
+          "[td365][token]") {
+    fake_venue venue({.delay = 300ms});
+    net::io_context ioc;
+    td365::td365 client(ioc.get_executor());
+    REQUIRE(connect_to(client, venue, ioc));
+
+    bool answered = false;
+    bool answered_before_stop = false;
+    client.async_get_market_details(
+        1, [&](std::exception_ptr e, td365::market_details_response) {
+            answered = !e;
+        });
+    client.async_stop([&](std::exception_ptr) {
+        answered_before_stop = answered;
+        ioc.stop();
+    });
+    ioc.run_for(10s);
+    CHECK(answered_before_stop);
+}
+
+TEST_CASE("td365 async_stop ignores operations never started",
+          "[td365][token]") {
+    fake_venue venue;
+    net::io_context ioc;
+    td365::td365 client(ioc.get_executor());
+    REQUIRE(connect_to(client, venue, ioc));
+
+    {
+        // created but dropped without being initiated
+        auto op = client.async_get_market_details(1, net::deferred);
+    }
+    bool stopped = false;
+    client.async_stop([&](std::exception_ptr e) {
+        stopped = !e;
+        ioc.stop();
+    });
+    ioc.run_for(10s);
+    CHECK(stopped);
+    CHECK(venue.host.details() == 0);
+}
+
+TEST_CASE("td365 async requests fail once stopped", "[td365][token]") {
+    fake_venue venue;
+    net::io_context ioc;
+    td365::td365 client(ioc.get_executor());
+    REQUIRE(connect_to(client, venue, ioc));
+
+    client.async_stop([](std::exception_ptr) {});
+    ioc.run_for(10s);
+    ioc.restart();
+
+    std::exception_ptr error;
+    client.async_get_market_details(
+        1, [&](std::exception_ptr e, td365::market_details_response) {
+            error = e;
+        });
+    ioc.run_for(10s);
+    CHECK(error);
+    CHECK(venue.host.details() == 0);
+}
+
+TEST_CASE("td365 on an executor run by several threads", "[td365][executor]") {
+    fake_venue venue;
+    net::io_context ioc;
+    td365::td365 client(ioc.get_executor());
+    auto work = net::make_work_guard(ioc);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&] { ioc.run(); });
+    }
+
+    client.async_connect(venue.detail(), net::use_future).get();
+    std::vector<std::future<td365::market_details_response>> replies;
+    for (int i = 0; i < 16; ++i) {
+        replies.push_back(client.async_get_market_details(1, net::use_future));
+    }
+    for (auto &r : replies) {
+        CHECK_NOTHROW(r.get());
+    }
+    client.async_stop(net::use_future).get();
+
+    work.reset();
+    ioc.stop();
+    for (auto &t : threads) {
+        t.join();
+    }
+    CHECK(venue.host.details() == 16);
+}
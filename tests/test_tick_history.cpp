@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include "tick_fixture.h"
+#include <td365/tick_history.h>
+
+#include <atomic>
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+td365::tick::time_type at_ms(std::int64_t ms) {
+    return td365::tick::time_type(std::chrono::milliseconds(ms));
+}
+} // namespace
+
+TEST_CASE("tick_history looks up by time", "[tick_history]") {
+    td365::tick_history history(8, 4);
+
+    for (int i = 0; i < 5; ++i) {
+        history.record(make_tick(1, 99.5 + i, 100.5 + i, at_ms(i * 100)));
+    }
+    REQUIRE(history.size(1) == 5);
+    REQUIRE(history.size(2) == 0);
+
+    // "what was the mid 250ms in?" -> the 200ms sample
+    REQUIRE(history.at(1, at_ms(250))->mid_price == 102);
+    REQUIRE(history.at(1, at_ms(200))->mid_price == 102);
+    REQUIRE(history.at(1, at_ms(10000))->mid_price == 104);
+    REQUIRE_FALSE(history.at(1, at_ms(-1)).has_value());
+    REQUIRE_FALSE(history.at(2, at_ms(0)).has_value());
+
+    std::vector<double> mids;
+    auto n = history.for_each(1, at_ms(100), at_ms(400),
+                              [&](const td365::tick_sample &s) {
+                                  mids.push_back(s.mid_price);
+                              });
+    REQUIRE(n == 3);
+    REQUIRE(mids == std::vector<double>{101, 102, 103});
+
+    SECTION("out of order ticks are dropped") {
+        history.record(make_tick(1, 998.5, 999.5, at_ms(50)));
+        REQUIRE(history.size(1) == 5);
+    }
+
+    SECTION("the ring keeps only the newest `capacity` samples") {
+        for (int i = 5; i < 20; ++i) {
+            history.record(
+                make_tick(1, 99.5 + i, 100.5 + i, at_ms(i * 100)));
+        }
+        REQUIRE(history.size(1) == 8);
+        REQUIRE_FALSE(history.at(1, at_ms(1100)).has_value());
+        REQUIRE(history.at(1, at_ms(1200))->mid_price == 112);
+
+        mids.clear();
+        history.for_each(1, at_ms(0), at_ms(100000),
+                         [&](const auto &s) { mids.push_back(s.mid_price); });
+        REQUIRE(mids.size() == 8);
+        REQUIRE(mids.front() == 112);
+        REQUIRE(mids.back() == 119);
+    }
+
+    SECTION("quotes beyond max_quotes are dropped") {
+        for (int q = 2; q < 10; ++q) {
+            history.record(make_tick(q, 0.5, 1.5, at_ms(0)));
+        }
+        REQUIRE(history.size(4) == 1);
+        REQUIRE(history.size(5) == 0);
+    }
+}
+
+TEST_CASE("tick_history readers race a lapping writer", "[tick_history]") {
+    td365::tick_history history(64, 1);
+    constexpr int updates = 200000;
+
+    std::atomic<bool> done = false;
+    std::atomic<int> bad = 0;
+    std::atomic<int> truncated = 0;
+    std::thread reader([&] {
+        while (!done.load(std::memory_order_relaxed)) {
+            // the newest sample when we start must still be delivered,
+            // however often the writer laps us on the way there
+            const auto newest = history.at(1, at_ms(updates));
+            std::int64_t last = -1;
+            history.for_each(1, at_ms(0), at_ms(updates + 1),
+                             [&](const td365::tick_sample &s) {
+                                 auto ms = std::chrono::duration_cast<
+                                               std::chrono::milliseconds>(
+                                               s.timestamp.time_since_epoch())
+                                               .count();
+                                 // samples are whole and in order
+                                 if (s.mid_price != static_cast<double>(ms) ||
+                                     ms <= last) {
+                                     bad++;
+                                 }
+                                 last = ms;
+                             });
+            if (newest &&
+                last < static_cast<std::int64_t>(newest->mid_price)) {
+                truncated++;
+            }
+        }
+    });
+
+    for (int i = 1; i <= updates; ++i) {
+        history.record(make_tick(1, i - 0.5, i + 0.5, at_ms(i)));
+    }
+    done = true;
+    reader.join();
+
+    REQUIRE(bad.load() == 0);
+    REQUIRE(truncated.load() == 0);
+    REQUIRE(history.at(1, at_ms(updates))->mid_price == updates);
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#include "tick_fixture.h"
+#include <td365/tick_store.h>
+
+#include <catch2/catch_all.hpp>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+std::string store_dir(std::string_view name) {
+    auto dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    return dir.string();
+}
+
+// 2025-03-04 09:00:00 UTC
+constexpr std::int64_t day_start_ms = 1741078800000;
+
+// the i-th tick of `quote_id`, with every stored field set
+td365::tick sample_tick(int quote_id, int i) {
+    // irregular spacing exercises the delta-of-delta timestamps
+    const auto ts = td365::tick::time_type(
+        std::chrono::milliseconds(day_start_ms + i * 250 + (i % 4) * 3));
+    // decimal prices, as parsed off the wire
+    auto t =
+        make_tick(quote_id, (81234 + i) / 10.0, (81246 + i) / 10.0, ts);
+    t.mid_price = (81240 + i) / 10.0;
+    t.high = 8200.25;
+    t.low = 8001.5 - i;
+    t.daily_change = (i - 1230) / 100.0;
+    t.dir = i % 2 ? td365::direction::up : td365::direction::down;
+    t.tradable = true;
+    t.call_only = i % 3 == 0;
+    t.field13 = 7 + i;
+    t.group = td365::grouping::grouped;
+    t.hash = "hash" + std::to_string(i);
+    t.received = t.timestamp + std::chrono::microseconds(400 + i);
+    return t;
+}
+
+// stored_tick::hash points into the reader's mapping, so callers only get
+// to keep the rest
+std::vector<td365::stored_tick> read_all(const std::string &path) {
+    td365::tick_segment_reader reader(path);
+    std::vector<td365::stored_tick> out;
+    td365::stored_tick t;
+    while (reader.next(t)) {
+        t.hash = {};
+        out.push_back(t);
+    }
+    return out;
+}
+} // namespace
+
+TEST_CASE("tick_store round trips ticks", "[tick_store]") {
+    const auto dir = store_dir("td365_tick_store");
+    constexpr int n = 300;
+
+    {
+        td365::tick_store store(dir, {.store_hash = true, .block_ticks = 128});
+        for (int i = 0; i < n; ++i) {
+            REQUIRE(store.append(sample_tick(42, i)));
+        }
+        REQUIRE(store.dropped() == 0);
+    } // joins the writer, flushing the partial last block
+
+    const auto path = td365::tick_store::segment_path(
+        dir, 42, sample_tick(42, 0).timestamp);
+    REQUIRE(path.ends_with("/42/2025-03-04.ticks"));
+
+    // hashes included, a fraction of the eight doubles and two timestamps
+    // each tick started as
+    REQUIRE(std::filesystem::file_size(path) < n * 32);
+
+    td365::tick_segment_reader reader(path);
+    REQUIRE(reader.quote_id() == 42);
+    td365::stored_tick got;
+    for (int i = 0; i < n; ++i) {
+        REQUIRE(reader.next(got));
+        const auto want = sample_tick(42, i);
+        REQUIRE(got.quote_id == 42);
+        REQUIRE(got.timestamp == want.timestamp);
+        REQUIRE(got.received == want.received);
+        REQUIRE(got.bid == want.bid);
+        REQUIRE(got.ask == want.ask);
+        REQUIRE(got.mid_price == want.mid_price);
+        REQUIRE(got.high == want.high);
+        REQUIRE(got.low == want.low);
+        REQUIRE(got.daily_change == want.daily_change);
+        REQUIRE(got.dir == want.dir);
+        REQUIRE(got.tradable == want.tradable);
+        REQUIRE(got.call_only == want.call_only);
+        REQUIRE(got.field13 == want.field13);
+        REQUIRE(got.group == want.group);
+        REQUIRE(got.hash == want.hash);
+    }
+    REQUIRE_FALSE(reader.next(got));
+
+    SECTION("reopening appends to the same segment") {
+        {
+            td365::tick_store store(dir);
+            store.append(sample_tick(42, n));
+        }
+        td365::tick_segment_reader more(path);
+        for (int i = 0; i < n; ++i) {
+            REQUIRE(more.next(got));
+        }
+        REQUIRE(more.next(got));
+        REQUIRE(got.timestamp == sample_tick(42, n).timestamp);
+        REQUIRE(got.hash.empty()); // not stored by default
+        REQUIRE_FALSE(more.next(got));
+    }
+
+    SECTION("a torn last block is ignored, then overwritten") {
+        const auto size = std::filesystem::file_size(path);
+        {
+            std::ofstream f(path, std::ios::binary | std::ios::app);
+            const char junk[] = {'T', 'B', 'L', 'K', 9, 9, 9};
+            f.write(junk, sizeof(junk));
+        }
+        REQUIRE(read_all(path).size() == n);
+
+        {
+            td365::tick_store store(dir);
+            store.append(sample_tick(42, n));
+        }
+        REQUIRE(std::filesystem::file_size(path) > size);
+        REQUIRE(read_all(path).size() == n + 1);
+    }
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("tick_store splits segments by quote and day", "[tick_store]") {
+    const auto dir = store_dir("td365_tick_store_days");
+    auto late = sample_tick(1, 0);
+    late.timestamp += 20h; // next UTC day
+
+    {
+        td365::tick_store store(dir);
+        store.append(sample_tick(1, 0));
+        store.append(sample_tick(2, 0));
+        store.append(late);
+    }
+
+    REQUIRE(read_all(td365::tick_store::segment_path(dir, 1, late.timestamp))
+                .size() == 1);
+    REQUIRE(read_all(td365::tick_store::segment_path(
+                         dir, 1, sample_tick(1, 0).timestamp))
+                .size() == 1);
+    REQUIRE(read_all(td365::tick_store::segment_path(
+                         dir, 2, sample_tick(2, 0).timestamp))
+                .size() == 1);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("tick_store cuts off a block it could not write", "[tick_store]") {
+    const auto dir = store_dir("td365_tick_store_short");
+    constexpr int block = 16;
+    const auto path = td365::tick_store::segment_path(
+        dir, 5, sample_tick(5, 0).timestamp);
+
+    {
+        td365::tick_store store(dir, {.block_ticks = block});
+        for (int i = 0; i < 2 * block; ++i) {
+            store.append(sample_tick(5, i));
+        }
+    }
+    const auto size = std::filesystem::file_size(path);
+
+    // files may not grow more than a few bytes: the next block is cut short
+    rlimit saved{};
+    ::getrlimit(RLIMIT_FSIZE, &saved);
+    auto *old_handler = std::signal(SIGXFSZ, SIG_IGN);
+    {
+        td365::tick_store store(dir, {.block_ticks = block});
+        rlimit small = saved;
+        small.rlim_cur = size + 8;
+        ::setrlimit(RLIMIT_FSIZE, &small);
+        for (int i = 2 * block; i < 3 * block; ++i) {
+            store.append(sample_tick(5, i));
+        }
+        // a full block is written as soon as the writer sees it
+        std::this_thread::sleep_for(200ms);
+        ::setrlimit(RLIMIT_FSIZE, &saved);
+        CHECK(std::filesystem::file_size(path) == size);
+
+        for (int i = 3 * block; i < 4 * block; ++i) {
+            store.append(sample_tick(5, i));
+        }
+    }
+    ::setrlimit(RLIMIT_FSIZE, &saved);
+    std::signal(SIGXFSZ, old_handler);
+
+    // the lost block is gone, and the one after it is readable
+    const auto got = read_all(path);
+    REQUIRE(got.size() == 3 * block);
+    CHECK(got[2 * block].timestamp == sample_tick(5, 3 * block).timestamp);
+
+    std::filesystem::remove_all(dir);
+}
@@ -5,6 +5,7 @@
  * Use in compliance with the Prosperity Public License 3.0.0.
  */
 
+#include "fake_feed_server.h"
 #include <td365/types.h>
 #include <td365/ws_client.h>
 
@@ -36,104 +37,6 @@ namespace net = boost::asio;
 using tcp = net::ip::tcp;
 using nlohmann::json;
 
-// Fake WebSocket server for testing
-class fake_ws_server {
-  public:
-    fake_ws_server(net::io_context &ioc, unsigned short port)
-        : ioc_(ioc), acceptor_(ioc, tcp::endpoint(tcp::v4(), port)) {
-        // Get the actual port number assigned by the system
-        port_ = acceptor_.local_endpoint().port();
-    }
-
-    boost::asio::awaitable<void> run(std::atomic<bool> &shutdown) {
-        while (!shutdown.load()) {
-            try {
-                tcp::socket socket =
-                    co_await acceptor_.async_accept(boost::asio::use_awaitable);
-
-                // Handle WebSocket connection
-                co_await handle_websocket_connection(std::move(socket),
-                                                     shutdown);
-            } catch (const std::exception &e) {
-                if (!shutdown.load()) {
-                    // Only log if not shutting down
-                    spdlog::debug("Server accept error: {}", e.what());
-                }
-                break;
-            }
-        }
-    }
-
-    void set_disconnect_after_connect(bool disconnect) {
-        disconnect_after_connect_ = disconnect;
-    }
-
-    void set_disconnect_delay(std::chrono::milliseconds delay) {
-        disconnect_delay_ = delay;
-    }
-
-    int get_connection_count() const { return connection_count_.load(); }
-
-    unsigned short get_port() const { return port_; }
-
-  private:
-    boost::asio::awaitable<void>
-    handle_websocket_connection(tcp::socket socket,
-                                std::atomic<bool> &shutdown) {
-        try {
-            websocket::stream<tcp::socket> ws(std::move(socket));
-
-            // Accept the WebSocket handshake
-            co_await ws.async_accept(boost::asio::use_awaitable);
-
-            connection_count_++;
-
-            json j = {{"t", "connectResponse"}};
-            co_await ws.async_write(
-                net::buffer(j.dump().c_str(), j.dump().size() + 1),
-                boost::asio::use_awaitable);
-
-            if (disconnect_after_connect_) {
-                // Wait for specified delay then disconnect
-                net::steady_timer timer(ioc_);
-                timer.expires_after(disconnect_delay_);
-                co_await timer.async_wait(boost::asio::use_awaitable);
-
-                // Close the connection
-                co_await ws.async_close(websocket::close_code::normal,
-                                        boost::asio::use_awaitable);
-            } else {
-                // Stay connected and handle messages
-                while (!shutdown.load()) {
-                    try {
-                        beast::flat_buffer buffer;
-                        co_await ws.async_read(buffer,
-                                               boost::asio::use_awaitable);
-
-                        // Echo back any received message
-                        co_await ws.async_write(buffer.data(),
-                                                boost::asio::use_awaitable);
-
-                    } catch (const std::exception &) {
-                        // Connection closed by client
-                        break;
-                    }
-                }
-            }
-        } catch (const std::exception &e) {
-            spdlog::debug("WebSocket connection error: {}", e.what());
-        }
-    }
-
-    net::io_context &ioc_;
-    tcp::acceptor acceptor_;
-    unsigned short port_;
-    std::atomic<bool> disconnect_after_connect_ = false;
-    std::chrono::milliseconds disconnect_delay_ =
-        std::chrono::milliseconds(1000);
-    std::atomic<int> connection_count_ = 0;
-};
-
 TEST_CASE("WebSocket client reconnection test - non-existent server",
           "[websocket][reconnect][none]") {
     // Create client with callbacks
@@ -211,7 +114,7 @@ TEST_CASE("WebSocket client reconnection test - server disconnects",
     net::io_context client_ioc;
 
     // Create fake server that will disconnect after connection
-    fake_ws_server server(server_ioc, 0); // Use port 0 to let system assign
+    fake_feed_server server(server_ioc, 0); // Use port 0 to let system assign
     server.set_disconnect_after_connect(true);
     server.set_disconnect_delay(std::chrono::milliseconds(500));
 
@@ -304,3 +207,229 @@ TEST_CASE("WebSocket client reconnection test - server disconnects",
     spdlog::info("Server received {} connection attempts",
                  server.get_connection_count());
 }
+
+TEST_CASE("WebSocket client handshake and streaming - fake feed",
+          "[websocket][fake][feed]") {
+    net::io_context server_ioc;
+    net::io_context client_ioc;
+
+    fake_feed_server server(server_ioc, 0,
+                            {.rate = 200, .burst = 2, .stream = true});
+
+    std::atomic<bool> server_shutdown = false;
+    std::atomic<bool> client_shutdown = false;
+
+    boost::asio::co_spawn(server_ioc, server.run(server_shutdown),
+                          boost::asio::detached);
+    std::thread server_thread([&server_ioc]() { server_ioc.run(); });
+
+    std::atomic<int> ticks = 0;
+    std::atomic<int> wrong_quote = 0;
+    std::atomic<int> bad_stamps = 0;
+    std::atomic<int> wrong_group = 0;
+    td365::user_callbacks callbacks;
+    callbacks.tick_cb = [&](td365::tick &&t) {
+        if (t.quote_id != 900001 && t.quote_id != 900002) {
+            wrong_quote++;
+        }
+        // each quote is on its own stream
+        if (t.group != (t.quote_id == 900001 ? td365::grouping::grouped
+                                              : td365::grouping::sampled)) {
+            wrong_group++;
+        }
+        // arrival is stamped, and before decoding finished
+        if (t.received == td365::tick::time_type{} ||
+            t.process_latency() < std::chrono::nanoseconds(0)) {
+            bad_stamps++;
+        }
+        ticks++;
+    };
+    auto client = std::make_unique<td365::ws_client>(callbacks);
+
+    std::atomic<bool> client_coroutine_done = false;
+    boost::asio::co_spawn(
+        client_ioc,
+        [&]() -> boost::asio::awaitable<void> {
+            try {
+                boost::urls::url url("ws://127.0.0.1:" +
+                                     std::to_string(server.get_port()));
+                co_await client->run(url, "test_login", "test_token",
+                                     client_shutdown);
+            } catch (const std::exception &e) {
+                spdlog::debug("client failed: {}", e.what());
+            }
+            client_coroutine_done = true;
+        },
+        boost::asio::detached);
+    std::thread client_thread([&client_ioc]() { client_ioc.run(); });
+
+    // authenticationResponse completes the handshake
+    client->wait_for_auth();
+
+    boost::asio::co_spawn(client_ioc,
+                          client->subscribe(900001, td365::grouping::grouped),
+                          boost::asio::use_future)
+        .get();
+    boost::asio::co_spawn(client_ioc, client->subscribe(900002),
+                          boost::asio::use_future)
+        .get();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    client_shutdown = true;
+    server_shutdown = true;
+    while (!client_coroutine_done) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    client_ioc.stop();
+    server_ioc.stop();
+    client_thread.join();
+    server_thread.join();
+    client.reset();
+
+    REQUIRE(server.get_connection_count() == 1);
+    // one snapshot per subscription plus the streamed prices
+    REQUIRE(ticks.load() > 2);
+    REQUIRE(wrong_quote.load() == 0);
+    REQUIRE(bad_stamps.load() == 0);
+    REQUIRE(wrong_group.load() == 0);
+}
+
+TEST_CASE("WebSocket client shares the caller's io_context",
+          "[websocket][fake][executor]") {
+    net::io_context server_ioc;
+    fake_feed_server server(server_ioc, 0,
+                            {.rate = 200, .burst = 2, .stream = true});
+    std::atomic<bool> server_shutdown = false;
+    boost::asio::co_spawn(server_ioc, server.run(server_shutdown),
+                          boost::asio::detached);
+    std::thread server_thread([&server_ioc]() { server_ioc.run(); });
+
+    // client and "strategy" on one context, run by this thread
+    net::io_context ioc;
+    const auto loop_thread = std::this_thread::get_id();
+    int ticks = 0;
+    int off_thread = 0;
+    td365::user_callbacks callbacks;
+    callbacks.tick_cb = [&](td365::tick &&) {
+        if (std::this_thread::get_id() != loop_thread) {
+            off_thread++;
+        }
+        ticks++;
+    };
+    td365::ws_client client(callbacks);
+    std::atomic<bool> client_shutdown = false;
+
+    boost::asio::co_spawn(
+        ioc,
+        [&]() -> boost::asio::awaitable<void> {
+            boost::urls::url url("ws://127.0.0.1:" +
+                                 std::to_string(server.get_port()));
+            co_await client.run(url, "test_login", "test_token",
+                                client_shutdown);
+        },
+        boost::asio::detached);
+
+    bool authenticated = false;
+    boost::asio::co_spawn(
+        ioc,
+        [&]() -> boost::asio::awaitable<void> {
+            co_await client.authenticated();
+            authenticated = true;
+            co_await client.subscribe(900002);
+            net::steady_timer wait(ioc, std::chrono::milliseconds(500));
+            co_await wait.async_wait(boost::asio::use_awaitable);
+            client_shutdown = true;
+        },
+        boost::asio::detached);
+
+    ioc.run_for(std::chrono::seconds(10));
+
+    server_shutdown = true;
+    server_ioc.stop();
+    server_thread.join();
+
+    REQUIRE(authenticated);
+    REQUIRE(ticks > 1);
+    REQUIRE(off_thread == 0);
+}
+
+TEST_CASE("WebSocket client reports a feed that stops before authenticating",
+          "[websocket][executor]") {
+    net::io_context ioc;
+    td365::user_callbacks callbacks;
+    td365::ws_client client(callbacks);
+    std::atomic<bool> shutdown = true; // run returns at once
+
+    boost::asio::co_spawn(
+        ioc,
+        [&]() -> boost::asio::awaitable<void> {
+            boost::urls::url url("ws://127.0.0.1:1");
+            co_await client.run(url, "test_login", "test_token", shutdown);
+        },
+        boost::asio::detached);
+
+    bool threw = false;
+    boost::asio::co_spawn(
+        ioc,
+        [&]() -> boost::asio::awaitable<void> {
+            try {
+                co_await client.authenticated();
+            } catch (const std::exception &) {
+                threw = true;
+            }
+        },
+        boost::asio::detached);
+    ioc.run_for(std::chrono::seconds(5));
+
+    REQUIRE(threw);
+}
+
+TEST_CASE("WebSocket client close ends a pending read",
+          "[websocket][fake][executor]") {
+    net::io_context server_ioc;
+    fake_feed_server server(server_ioc, 0, {.stream = false});
+    std::atomic<bool> server_shutdown = false;
+    boost::asio::co_spawn(server_ioc, server.run(server_shutdown),
+                          boost::asio::detached);
+    std::thread server_thread([&server_ioc]() { server_ioc.run(); });
+
+    net::io_context ioc;
+    td365::user_callbacks callbacks;
+    td365::ws_client client(callbacks);
+    std::atomic<bool> client_shutdown = false;
+
+    bool returned = false;
+    boost::asio::co_spawn(
+        ioc,
+        [&]() -> boost::asio::awaitable<void> {
+            boost::urls::url url("ws://127.0.0.1:" +
+                                 std::to_string(server.get_port()));
+            co_await client.run(url, "test_login", "test_token",
+                                client_shutdown);
+            returned = true;
+        },
+        boost::asio::detached);
+    boost::asio::co_spawn(
+        ioc,
+        [&]() -> boost::asio::awaitable<void> {
+            co_await client.authenticated();
+            // nothing more is coming, so run is waiting in a read
+            client_shutdown = true;
+            co_await client.close();
+        },
+        boost::asio::detached);
+
+    // returns once run has, rather than at the timeout
+    const auto start = std::chrono::steady_clock::now();
+    ioc.run_for(std::chrono::seconds(10));
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    server_shutdown = true;
+    server_ioc.stop();
+    server_thread.join();
+
+    REQUIRE(returned);
+    REQUIRE(elapsed < std::chrono::seconds(5));
+}
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2025, Matt Wlazlo
+ *
+ * This file is part of the td365 project.
+ * Use in compliance with the Prosperity Public License 3.0.0.
+ */
+
+#pragma once
+
+#include <td365/types.h>
+
+// A tick with its top of book set and the mid between bid and ask; every
+// other field is zero. Tests fill in whatever else they need.
+inline td365::tick make_tick(int quote_id, double bid, double ask,
+                             td365::tick::time_type ts) {
+    td365::tick t{};
+    t.quote_id = quote_id;
+    t.bid = bid;
+    t.ask = ask;
+    t.mid_price = (bid + ask) / 2;
+    t.timestamp = ts;
+    return t;
+}